@@ -11,12 +11,26 @@
 
 #include "api.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include "artwork.h"
 #include "broadcast.h"
+#include "cache.h"
 #include "chromecast.h"
 #include "device.h"
 #include "equalizer.h"
+#include "internal/threadpool.h"
+#include "keyframes.h"
+#include "library.h"
+#include "loudness.h"
 #include "player.h"
 #include "record.h"
+#include "thumbnails.h"
+#include "waveform.h"
 
 namespace DartObjects {
 
@@ -38,10 +52,65 @@ struct Equalizer {
   std::vector<float> amps;
 };
 
-static void DestroyObject(void*, void* peer) { delete peer; }
+struct MediaTracksList {
+  // The track lists that get exposed to Dart.
+  DartMediaTracksList dart_object;
+
+  // Backing data
+  std::vector<DartMediaTracks> medias;
+  std::vector<std::vector<DartMediaTrack>> track_infos;
+  std::vector<std::shared_ptr<Media>> media_items;
+};
+
+struct ThumbnailStrip {
+  // The strip that gets exposed to Dart.
+  DartThumbnailStrip dart_object;
+
+  // Backing data
+  ::ThumbnailStrip strip;
+  std::vector<const char*> sheets;
+  std::vector<DartThumbnail> thumbnails;
+};
+
+struct Waveform {
+  // The waveform that gets exposed to Dart.
+  DartWaveform dart_object;
+
+  // Backing data
+  std::shared_ptr<const ::Waveform> waveform;
+  std::vector<DartWaveformLevel> levels;
+};
+
+template <typename T>
+static void DestroyObject(void*, void* peer) {
+  delete reinterpret_cast<T*>(peer);
+}
 
 }  // namespace DartObjects
 
+static void CopyJobStats(const StreamOutputJob::Stats& source,
+                         DartJobStats* stats) {
+  stats->state = source.state;
+  stats->position = source.position;
+  stats->time = source.time;
+  stats->length = source.length;
+  stats->rate = source.rate;
+  stats->read_bytes = source.read_bytes;
+  stats->input_bitrate = source.input_bitrate;
+  stats->demux_read_bytes = source.demux_read_bytes;
+  stats->demux_bitrate = source.demux_bitrate;
+  stats->demux_corrupted = source.demux_corrupted;
+  stats->decoded_video = source.decoded_video;
+  stats->decoded_audio = source.decoded_audio;
+  stats->lost_pictures = source.lost_pictures;
+  stats->late_pictures = source.late_pictures;
+  stats->lost_audio_buffers = source.lost_audio_buffers;
+  stats->sent_bytes = source.sent_bytes;
+  stats->send_bitrate = source.send_bitrate;
+  stats->bytes = source.bytes;
+  stats->bitrate = source.bitrate;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -69,6 +138,26 @@ void PlayerCreate(int32_t id, int32_t video_width, int32_t video_height,
   player->OnPosition([=](int32_t) -> void { OnPosition(id, player->state()); });
   player->OnOpen([=](VLC::Media) -> void { OnOpen(id, player->state()); });
   player->OnPlaylist([=]() -> void { OnOpen(id, player->state()); });
+  player->OnSeek([=](int64_t target, int64_t time, int64_t latency,
+                     int32_t dropped) -> void {
+    OnSeek(id, target, time, latency, dropped);
+  });
+  player->OnGapless([=](int32_t index, int64_t gap) -> void {
+    OnGapless(id, index, gap);
+  });
+  player->OnAudioFormat([=](int32_t rate, int32_t channels) -> void {
+    OnAudioFormat(id, rate, channels);
+  });
+  player->OnAnalysis([=](const AudioAnalyzer::Analysis& analysis) -> void {
+    OnAnalysis(id, analysis.bands.data(),
+               static_cast<int32_t>(analysis.bands.size()),
+               analysis.rms.data(), analysis.peak.data(),
+               static_cast<int32_t>(analysis.rms.size()));
+  });
+  player->OnLoop([=](int32_t iteration) -> void { OnLoop(id, iteration); });
+  player->OnRecording([=](bool is_recording, const std::string& path) -> void {
+    OnRecording(id, is_recording, path);
+  });
 #ifdef _WIN32
 /* Windows: Texture & flutter::TextureRegistrar */
 #else
@@ -144,6 +233,88 @@ void PlayerSeek(int32_t id, int32_t position) {
   player->Seek(position);
 }
 
+void PlayerSeekTime(int32_t id, int64_t time, int32_t mode) {
+  Player* player = g_players->Get(id);
+  player->SeekTime(time, mode == SeekMode::fast ? SeekMode::fast
+                                                : SeekMode::precise);
+}
+
+void PlayerScrub(int32_t id, int64_t time, bool is_dragging) {
+  Player* player = g_players->Get(id);
+  player->Scrub(time, is_dragging);
+}
+
+void PlayerNextFrame(int32_t id) {
+  Player* player = g_players->Get(id);
+  player->NextFrame();
+}
+
+void PlayerPreviousFrame(int32_t id) {
+  Player* player = g_players->Get(id);
+  player->PreviousFrame();
+}
+
+int32_t PlayerEnableAudioTap(int32_t id, int32_t rate, int32_t channels,
+                             int32_t layout, int32_t capacity, bool passthrough,
+                             DartAudioRing* rings, int32_t rings_size) {
+  Player* player = g_players->Get(id);
+  AudioTap* tap = player->EnableAudioTap(
+      rate, channels, static_cast<AudioTap::Layout>(layout), capacity,
+      passthrough);
+  int32_t count = 0;
+  for (auto& ring : tap->rings()) {
+    if (count < rings_size) {
+      rings[count] = DartAudioRing{
+          reinterpret_cast<uint64_t*>(ring->write_position()),
+          reinterpret_cast<uint64_t*>(ring->read_position()), ring->data(),
+          static_cast<int64_t>(ring->capacity())};
+    }
+    count++;
+  }
+  return count;
+}
+
+void PlayerSetAnalysis(int32_t id, int32_t bands, int32_t fft_size,
+                       int32_t frequency) {
+  Player* player = g_players->Get(id);
+  player->SetAnalysis(bands, fft_size, frequency);
+}
+
+int32_t PlayerGetAnalysis(int32_t id, float* bands, int32_t band_count,
+                          float* rms, float* peak) {
+  Player* player = g_players->Get(id);
+  AudioAnalyzer::Analysis analysis = player->analysis();
+  std::copy_n(analysis.bands.begin(),
+              std::min<size_t>(band_count, analysis.bands.size()), bands);
+  size_t channels =
+      std::min<size_t>(AudioTap::kMaxChannels, analysis.rms.size());
+  std::copy_n(analysis.rms.begin(), channels, rms);
+  std::copy_n(analysis.peak.begin(), channels, peak);
+  return static_cast<int32_t>(channels);
+}
+
+void PlayerSetNormalization(int32_t id, int32_t mode, double target) {
+  Player* player = g_players->Get(id);
+  player->SetNormalization(static_cast<LoudnessMode>(mode), target);
+}
+
+void PlayerSetLoopRegion(int32_t id, int64_t start, int64_t end,
+                         int32_t count) {
+  Player* player = g_players->Get(id);
+  player->SetLoopRegion(start, end, count);
+}
+
+void PlayerStartRecording(int32_t id, const char* directory,
+                          const char* mux) {
+  Player* player = g_players->Get(id);
+  player->StartRecording(directory, mux);
+}
+
+void PlayerStopRecording(int32_t id) {
+  Player* player = g_players->Get(id);
+  player->StopRecording();
+}
+
 void PlayerSetVolume(int32_t id, float volume) {
   Player* player = g_players->Get(id);
   player->SetVolume(volume);
@@ -184,6 +355,22 @@ void PlayerSetPlaylistMode(int32_t id, const char* mode) {
   player->SetPlaylistMode(playlistMode);
 }
 
+void PlayerSetCrossfade(int32_t id, int32_t duration, int32_t curve) {
+  Player* player = g_players->Get(id);
+  player->SetCrossfade(duration, curve == Fader::equalPower ? Fader::equalPower
+                                                            : Fader::linear);
+}
+
+void PlayerSetShuffle(int32_t id, bool shuffle, int64_t seed) {
+  Player* player = g_players->Get(id);
+  player->SetShuffle(shuffle, static_cast<uint64_t>(seed));
+}
+
+void PlayerSetGapless(int32_t id, int32_t prefetch) {
+  Player* player = g_players->Get(id);
+  player->SetGapless(prefetch);
+}
+
 void PlayerAdd(int32_t id, const char* type, const char* resource) {
   Player* player = g_players->Get(id);
   std::shared_ptr<Media> media;
@@ -219,6 +406,43 @@ void PlayerMove(int32_t id, int32_t initial_index, int32_t final_index) {
   player->Move(initial_index, final_index);
 }
 
+void PlayerApply(int32_t id, const DartPlaylistOperation* operations,
+                 int32_t operations_size, const char** source,
+                 int32_t source_size) {
+  Player* player = g_players->Get(id);
+  PlaylistBatch batch;
+  int32_t source_index = 0;
+  for (int32_t i = 0; i < operations_size; i++) {
+    const DartPlaylistOperation& operation = operations[i];
+    std::vector<PlaylistBatch::Item> items;
+    if (operation.type == PlaylistBatch::add ||
+        operation.type == PlaylistBatch::replace) {
+      int32_t count =
+          std::min(operation.media_count, source_size - source_index);
+      items.reserve(std::max(count, 0));
+      for (int32_t j = 0; j < count; j++, source_index++) {
+        items.emplace_back(source[2 * source_index],
+                           source[2 * source_index + 1]);
+      }
+    }
+    switch (operation.type) {
+      case PlaylistBatch::add:
+        batch.Add(operation.index, std::move(items));
+        break;
+      case PlaylistBatch::remove:
+        batch.Remove(operation.index, operation.count);
+        break;
+      case PlaylistBatch::move:
+        batch.Move(operation.index, operation.count);
+        break;
+      case PlaylistBatch::replace:
+        batch.Replace(std::move(items));
+        break;
+    }
+  }
+  player->Apply(batch);
+}
+
 void MediaClearMap(void*, void* peer) {
   delete reinterpret_cast<std::map<std::string, std::string>*>(peer);
 }
@@ -244,6 +468,199 @@ const char** MediaParse(Dart_Handle object, const char* type,
   return values->data();
 }
 
+static void MediaMetasDestroy(void*, void* peer) { std::free(peer); }
+
+struct DartMediaMetas* MediaParseMetas(Dart_Handle object, const char* type,
+                                       const char* resource, int32_t timeout,
+                                       uint32_t mask, bool network) {
+  std::shared_ptr<Media> media = Media::create(type, resource);
+  media->parse(timeout, mask, network);
+  size_t size = 0;
+  for (const auto & [ key, value ] : media->metas()) size += value.size() + 1;
+  auto metas = static_cast<DartMediaMetas*>(
+      std::malloc(sizeof(DartMediaMetas) + size));
+  char* data = reinterpret_cast<char*>(metas + 1);
+  metas->mask = mask & Media::kMetaAll;
+  metas->data = data;
+  int32_t offset = 0;
+  for (int32_t index = 0; index < Media::kMetaCount; index++) {
+    auto it = media->metas().find(Media::kMetaFields[index].key);
+    if (it == media->metas().end()) {
+      metas->offsets[index] = -1;
+      metas->lengths[index] = 0;
+      continue;
+    }
+    const std::string& value = it->second;
+    memcpy(data + offset, value.c_str(), value.size() + 1);
+    metas->offsets[index] = offset;
+    metas->lengths[index] = static_cast<int32_t>(value.size());
+    offset += static_cast<int32_t>(value.size()) + 1;
+  }
+  Dart_NewFinalizableHandle_DL(
+      object, metas, sizeof(DartMediaMetas) + size,
+      static_cast<Dart_HandleFinalizer>(MediaMetasDestroy));
+  return metas;
+}
+
+struct DartMediaTracksList* MediaParseTracks(Dart_Handle object,
+                                             const char** source,
+                                             int32_t source_size,
+                                             int32_t timeout) {
+  auto wrapper = new DartObjects::MediaTracksList();
+  for (int32_t index = 0; index < 2 * source_size; index += 2) {
+    wrapper->media_items.emplace_back(
+        Media::create(source[index], source[index + 1]));
+  }
+  // The medias are parsed in parallel, the call returns once all of them are.
+  if (!wrapper->media_items.empty()) {
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t remaining = wrapper->media_items.size();
+    ThreadPool pool(std::min(ThreadPool::DefaultSize(), remaining));
+    for (const std::shared_ptr<Media>& media : wrapper->media_items) {
+      pool.Post([&, media]() {
+        media->parse(timeout, 1u << Media::kMetaDuration, false);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) condition.notify_one();
+      });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&]() -> bool { return remaining == 0; });
+  }
+  wrapper->track_infos.resize(wrapper->media_items.size());
+  for (size_t index = 0; index < wrapper->media_items.size(); index++) {
+    auto& track_infos = wrapper->track_infos[index];
+    for (const TrackInfo& track : wrapper->media_items[index]->tracks()) {
+      track_infos.push_back(DartMediaTrack{
+          track.type(), track.codec(), track.width(), track.height(),
+          track.frame_rate(), track.bitrate(), track.channels(),
+          track.sample_rate(), track.language().c_str()});
+    }
+    wrapper->medias.push_back(DartMediaTracks{
+        static_cast<int32_t>(track_infos.size()), track_infos.data()});
+  }
+  wrapper->dart_object.size = static_cast<int32_t>(wrapper->medias.size());
+  wrapper->dart_object.medias = wrapper->medias.data();
+  Dart_NewFinalizableHandle_DL(
+      object, wrapper, sizeof(*wrapper),
+      static_cast<Dart_HandleFinalizer>(
+          DartObjects::DestroyObject<DartObjects::MediaTracksList>));
+  return &wrapper->dart_object;
+}
+
+void CacheSetDirectory(const char* directory) {
+  g_cache->SetDirectory(directory);
+}
+
+const char* ArtworkGet(Dart_Handle object, const char* type,
+                       const char* resource, int32_t size) {
+  auto path = new std::string(
+      g_artwork_cache->Get(Media::create(type, resource), size));
+  Dart_NewFinalizableHandle_DL(
+      object, path, sizeof(*path),
+      static_cast<Dart_HandleFinalizer>(
+          DartObjects::DestroyObject<std::string>));
+  return path->c_str();
+}
+
+void ArtworkRequest(int32_t id, const char* type, const char* resource,
+                    int32_t size) {
+  g_artwork_cache->Request(
+      Media::create(type, resource), size,
+      [=](const std::string& path) -> void { OnArtwork(id, path); });
+}
+
+DartThumbnailStrip* ThumbnailsGet(Dart_Handle object, const char* type,
+                                  const char* resource, int32_t interval,
+                                  int32_t width) {
+  auto wrapper = new DartObjects::ThumbnailStrip();
+  wrapper->strip =
+      g_thumbnail_cache->Get(Media::create(type, resource), interval, width)
+          .value_or(::ThumbnailStrip());
+  for (const std::string& sheet : wrapper->strip.sheets) {
+    wrapper->sheets.emplace_back(sheet.c_str());
+  }
+  for (const auto& thumbnail : wrapper->strip.thumbnails) {
+    wrapper->thumbnails.push_back(
+        {thumbnail.time, thumbnail.sheet, thumbnail.x, thumbnail.y});
+  }
+  wrapper->dart_object.width = wrapper->strip.width;
+  wrapper->dart_object.height = wrapper->strip.height;
+  wrapper->dart_object.sheet_count =
+      static_cast<int32_t>(wrapper->sheets.size());
+  wrapper->dart_object.sheets = wrapper->sheets.data();
+  wrapper->dart_object.size = static_cast<int32_t>(wrapper->thumbnails.size());
+  wrapper->dart_object.thumbnails = wrapper->thumbnails.data();
+  Dart_NewFinalizableHandle_DL(
+      object, wrapper, sizeof(*wrapper),
+      static_cast<Dart_HandleFinalizer>(
+          DartObjects::DestroyObject<DartObjects::ThumbnailStrip>));
+  return &wrapper->dart_object;
+}
+
+void ThumbnailsRequest(int32_t id, const char* type, const char* resource,
+                       int32_t interval, int32_t width) {
+  g_thumbnail_cache->Request(
+      Media::create(type, resource), interval, width,
+      [=](const ThumbnailStrip& strip) -> void {
+        OnThumbnails(id, static_cast<int32_t>(strip.thumbnails.size()));
+      });
+}
+
+DartWaveform* WaveformGet(Dart_Handle object, const char* type,
+                          const char* resource) {
+  auto wrapper = new DartObjects::Waveform();
+  wrapper->waveform = g_waveform_generator->Get(Media::create(type, resource));
+  wrapper->dart_object = DartWaveform{0, 0, 0, 0, nullptr};
+  if (wrapper->waveform) {
+    for (const auto& level : wrapper->waveform->levels()) {
+      wrapper->levels.push_back(
+          {level.frames_per_bucket, level.buckets, level.data});
+    }
+    wrapper->dart_object.rate = wrapper->waveform->rate();
+    wrapper->dart_object.channels = wrapper->waveform->channels();
+    wrapper->dart_object.frames = wrapper->waveform->frames();
+    wrapper->dart_object.level_count =
+        static_cast<int32_t>(wrapper->levels.size());
+    wrapper->dart_object.levels = wrapper->levels.data();
+  }
+  Dart_NewFinalizableHandle_DL(
+      object, wrapper, sizeof(*wrapper),
+      static_cast<Dart_HandleFinalizer>(
+          DartObjects::DestroyObject<DartObjects::Waveform>));
+  return &wrapper->dart_object;
+}
+
+void WaveformRequest(int32_t id, const char* type, const char* resource) {
+  g_waveform_generator->Request(
+      Media::create(type, resource),
+      [=](std::shared_ptr<const Waveform> waveform) -> void {
+        OnWaveform(id, waveform ? waveform->frames() : 0);
+      });
+}
+
+void KeyframesRequest(int32_t id, const char* type, const char* resource) {
+  g_keyframe_indexer->Request(
+      Media::create(type, resource),
+      [=](std::shared_ptr<const KeyframeIndex> index) -> void {
+        OnKeyframes(id, index ? static_cast<int32_t>(index->keyframes.size())
+                              : 0);
+      });
+}
+
+void LoudnessRequest(int32_t id, const char* type, const char* resource) {
+  g_loudness_scanner->Request(
+      Media::create(type, resource),
+      [=](std::optional<Loudness> loudness) -> void {
+        if (loudness) {
+          OnLoudness(id, loudness->integrated, loudness->range,
+                     loudness->true_peak);
+        } else {
+          OnLoudness(id, LoudnessMeter::kSilence, 0.0, LoudnessMeter::kSilence);
+        }
+      });
+}
+
 void BroadcastCreate(int32_t id, const char* type, const char* resource,
                      const char* access, const char* mux, const char* dst,
                      const char* vcodec, int32_t vb, const char* acodec,
@@ -253,7 +670,28 @@ void BroadcastCreate(int32_t id, const char* type, const char* resource,
   std::unique_ptr<BroadcastConfiguration> configuration =
       std::make_unique<BroadcastConfiguration>(access, mux, dst, vcodec, vb,
                                                acodec, ab);
-  g_broadcasts->Get(id, std::move(media), std::move(configuration));
+  Broadcast* broadcast =
+      g_broadcasts->Get(id, std::move(media), std::move(configuration));
+  broadcast->OnState(
+      [=](StreamOutputJob::State state) -> void { OnBroadcast(id, state); });
+}
+
+void BroadcastCreateOutputs(int32_t id, const char* type,
+                            const char* resource,
+                            const DartBroadcastOutput* outputs,
+                            int32_t outputs_size) {
+  std::vector<BroadcastOutput> broadcast_outputs;
+  for (int32_t index = 0; index < outputs_size; index++) {
+    const DartBroadcastOutput& output = outputs[index];
+    broadcast_outputs.emplace_back(output.access, output.mux, output.dst,
+                                   output.vcodec, output.vb, output.acodec,
+                                   output.ab);
+  }
+  Broadcast* broadcast = g_broadcasts->Get(
+      id, Media::create(type, resource),
+      std::make_unique<BroadcastConfiguration>(broadcast_outputs));
+  broadcast->OnState(
+      [=](StreamOutputJob::State state) -> void { OnBroadcast(id, state); });
 }
 
 void BroadcastStart(int32_t id) {
@@ -261,25 +699,71 @@ void BroadcastStart(int32_t id) {
   broadcast->Start();
 }
 
+void BroadcastGetStats(int32_t id, DartJobStats* stats) {
+  Broadcast* broadcast = g_broadcasts->Get(id, nullptr, nullptr);
+  CopyJobStats(broadcast->stats(), stats);
+}
+
 void BroadcastDispose(int32_t id) { g_broadcasts->Dispose(id); }
 
 void ChromecastCreate(int32_t id, const char* type, const char* resource,
                       const char* ip_address) {
   std::shared_ptr<Media> media = Media::create(type, resource);
-  chromecasts->Get(id, std::move(media), ip_address);
+  g_chromecasts->Get(id, std::move(media), ip_address);
 }
 
 void ChromecastStart(int32_t id) {
-  Chromecast* chromecast = chromecasts->Get(id, nullptr, "");
+  Chromecast* chromecast = g_chromecasts->Get(id, nullptr, "");
   chromecast->Start();
 }
 
-void ChromecastDispose(int32_t id) { chromecasts->Dispose(id); }
+void ChromecastDispose(int32_t id) { g_chromecasts->Dispose(id); }
 
 void RecordCreate(int32_t id, const char* saving_file, const char* type,
                   const char* resource) {
   std::shared_ptr<Media> media = Media::create(type, resource);
-  g_records->Get(id, media, saving_file);
+  Record* record = g_records->Get(id, media, saving_file);
+  record->OnState(
+      [=](StreamOutputJob::State state) -> void { OnRecord(id, state); });
+}
+
+void RecordCreateSegmented(int32_t id, const char* directory,
+                           const char* type, const char* resource,
+                           int32_t segment_duration, int64_t max_age,
+                           int64_t max_bytes) {
+  Record* record =
+      g_records->Get(id, Media::create(type, resource), directory,
+                     RecordSegmentation{segment_duration, max_age, max_bytes});
+  record->OnState(
+      [=](StreamOutputJob::State state) -> void { OnRecord(id, state); });
+}
+
+void RecordCreatePreroll(int32_t id, const char* directory, const char* type,
+                         const char* resource, int32_t preroll,
+                         int64_t max_bytes) {
+  Record* record =
+      g_records->Get(id, Media::create(type, resource), directory,
+                     std::nullopt, RecordPreroll{preroll, max_bytes});
+  record->OnState(
+      [=](StreamOutputJob::State state) -> void { OnRecord(id, state); });
+  record->OnClip(
+      [=](const std::string& path) -> void { OnRecordClip(id, path); });
+}
+
+void RecordTrigger(int32_t id, int32_t post_seconds) {
+  Record* record = g_records->Get(id, nullptr, "");
+  record->Trigger(post_seconds);
+}
+
+const char* RecordFindSegment(Dart_Handle object, int32_t id, int64_t time,
+                              int64_t* offset) {
+  Record* record = g_records->Get(id, nullptr, "");
+  auto path = new std::string(record->FindSegment(time, offset).u8string());
+  Dart_NewFinalizableHandle_DL(
+      object, path, sizeof(*path),
+      static_cast<Dart_HandleFinalizer>(
+          DartObjects::DestroyObject<std::string>));
+  return path->c_str();
 }
 
 void RecordStart(int32_t id) {
@@ -287,11 +771,41 @@ void RecordStart(int32_t id) {
   record->Start();
 }
 
+void RecordGetStats(int32_t id, DartJobStats* stats) {
+  Record* record = g_records->Get(id, nullptr, "");
+  CopyJobStats(record->stats(), stats);
+}
+
 void RecordDispose(int32_t id) { g_records->Dispose(id); }
 
+bool LibraryCreate(int32_t id, const char** directories,
+                   int32_t directories_size, const char** extensions,
+                   int32_t extensions_size, bool sniff) {
+  if (!g_cache->enabled()) return false;
+  Library* library = g_libraries->Create(
+      id, std::vector<std::string>(directories, directories + directories_size),
+      std::vector<std::string>(extensions, extensions + extensions_size),
+      sniff);
+  library->OnProgress(
+      [=](int32_t scanned, int32_t parsed, bool completed) -> void {
+        OnLibraryProgress(id, scanned, parsed, completed);
+      });
+  library->OnChange([=](const char* change, const std::string& path) -> void {
+    OnLibraryChange(id, change, path);
+  });
+  return true;
+}
+
+void LibraryScan(int32_t id, bool watch) {
+  Library* library = g_libraries->Get(id);
+  if (library) library->Scan(watch);
+}
+
+void LibraryDispose(int32_t id) { g_libraries->Dispose(id); }
+
 DartDeviceList* DevicesAll(Dart_Handle object) {
   auto wrapper = new DartObjects::DeviceList();
-  wrapper->devices = Devices::All();
+  wrapper->devices = g_devices->All();
 
   for (const auto& device : wrapper->devices) {
     wrapper->device_infos.emplace_back(device.name().c_str(),
@@ -303,10 +817,17 @@ DartDeviceList* DevicesAll(Dart_Handle object) {
 
   Dart_NewFinalizableHandle_DL(
       object, wrapper, sizeof(*wrapper),
-      static_cast<Dart_HandleFinalizer>(DartObjects::DestroyObject));
+      static_cast<Dart_HandleFinalizer>(
+          DartObjects::DestroyObject<DartObjects::DeviceList>));
   return &wrapper->dart_object;
 }
 
+void DevicesWatch(int32_t id) {
+  g_devices->Watch([=](const std::vector<Device>& devices) -> void {
+    OnDevices(id, static_cast<int32_t>(devices.size()));
+  });
+}
+
 static DartEqualizer* EqualizerToDart(const Equalizer* equalizer, int32_t id,
                                       Dart_Handle dart_handle) {
   auto wrapper = new DartObjects::Equalizer();
@@ -323,7 +844,8 @@ static DartEqualizer* EqualizerToDart(const Equalizer* equalizer, int32_t id,
 
   Dart_NewFinalizableHandle_DL(
       dart_handle, wrapper, sizeof(*wrapper),
-      static_cast<Dart_HandleFinalizer>(DartObjects::DestroyObject));
+      static_cast<Dart_HandleFinalizer>(
+          DartObjects::DestroyObject<DartObjects::Equalizer>));
 
   return &wrapper->dart_object;
 }
@@ -40,6 +40,134 @@ struct DartEqualizer {
   int32_t size;
 };
 
+// Metadata returned by |MediaParseMetas|. All requested values live in a
+// single allocation after this struct; field |i| (see |Media::kMetaFields|)
+// starts at |data + offsets[i]| & is |lengths[i]| bytes long, null-terminated.
+// |offsets[i]| is -1 for fields which were not requested.
+struct DartMediaMetas {
+  uint32_t mask;
+  int32_t offsets[Media::kMetaCount];
+  int32_t lengths[Media::kMetaCount];
+  const char* data;
+};
+
+struct DartMediaTrack {
+  int32_t type;
+  uint32_t codec;
+  int32_t width;
+  int32_t height;
+  float frame_rate;
+  int32_t bitrate;
+  int32_t channels;
+  int32_t sample_rate;
+  const char* language;
+};
+
+struct DartMediaTracks {
+  int32_t size;
+  const DartMediaTrack* tracks;
+};
+
+// Tracks of each media passed to |MediaParseTracks|, in the same order. The
+// medias are parsed in parallel, but the call blocks until all of them are
+// parsed or timed out, i.e. for up to about |timeout| per batch of
+// |hardware_concurrency| medias.
+struct DartMediaTracksList {
+  int32_t size;
+  const DartMediaTracks* medias;
+};
+
+// An operation of |PlayerApply|. |type| is a |PlaylistBatch::Type|, the
+// meaning of |index| & |count| is the same as in |PlaylistBatch::Operation|.
+// |add| & |replace| consume the next |media_count| type/resource pairs of
+// |PlayerApply|'s |source|.
+struct DartPlaylistOperation {
+  int32_t type;
+  int32_t index;
+  int32_t count;
+  int32_t media_count;
+};
+
+struct DartThumbnail {
+  int64_t time;
+  int32_t sheet;
+  int32_t x;
+  int32_t y;
+};
+
+// Thumbnails returned by |ThumbnailsGet|, see |ThumbnailStrip|. |size| is 0
+// if the strip was not generated yet.
+struct DartThumbnailStrip {
+  int32_t width;
+  int32_t height;
+  int32_t sheet_count;
+  const char** sheets;
+  int32_t size;
+  const DartThumbnail* thumbnails;
+};
+
+// Ring of audio samples shared with Dart, see |RingBuffer|. The sample at
+// position |p| is |data[p % capacity]|. Samples up to |*write_position| are
+// readable, the reader advances |*read_position| once done with them.
+struct DartAudioRing {
+  uint64_t* write_position;
+  uint64_t* read_position;
+  float* data;
+  int64_t capacity;
+};
+
+// Level of a waveform, see |Waveform|. |data| holds |buckets| x channels
+// int16 triplets of minimum, maximum & RMS.
+struct DartWaveformLevel {
+  int32_t frames_per_bucket;
+  int32_t buckets;
+  const int16_t* data;
+};
+
+// Waveform returned by |WaveformGet|, mapped from its peaks file.
+// |level_count| is 0 if it was not generated yet.
+struct DartWaveform {
+  int32_t rate;
+  int32_t channels;
+  int64_t frames;
+  int32_t level_count;
+  const struct DartWaveformLevel* levels;
+};
+
+// Destination of a broadcast, see |BroadcastOutput|.
+struct DartBroadcastOutput {
+  const char* access;
+  const char* mux;
+  const char* dst;
+  const char* vcodec;
+  int32_t vb;
+  const char* acodec;
+  int32_t ab;
+};
+
+// Status of a broadcast or record, see |StreamOutputJob::Stats|.
+struct DartJobStats {
+  int32_t state;
+  float position;
+  int64_t time;
+  int64_t length;
+  float rate;
+  int64_t read_bytes;
+  double input_bitrate;
+  int64_t demux_read_bytes;
+  double demux_bitrate;
+  int64_t demux_corrupted;
+  int64_t decoded_video;
+  int64_t decoded_audio;
+  int64_t lost_pictures;
+  int64_t late_pictures;
+  int64_t lost_audio_buffers;
+  int64_t sent_bytes;
+  double send_bitrate;
+  int64_t bytes;
+  double bitrate;
+};
+
 DLLEXPORT void PlayerCreate(int32_t id, int32_t video_width,
                             int32_t video_height,
                             int32_t commandLineArgumentsCount,
@@ -65,6 +193,67 @@ DLLEXPORT void PlayerJump(int32_t id, int32_t index);
 
 DLLEXPORT void PlayerSeek(int32_t id, int32_t position);
 
+// Seeks to |time| microseconds. |mode| is a |SeekMode|. A "seekEvent" is
+// sent once the time is reached. Seeks requested while another one is in
+// flight replace each other.
+DLLEXPORT void PlayerSeekTime(int32_t id, int64_t time, int32_t mode);
+
+// Seeks from a seek bar, fast while |is_dragging| & precisely on release.
+DLLEXPORT void PlayerScrub(int32_t id, int64_t time, bool is_dragging);
+
+DLLEXPORT void PlayerNextFrame(int32_t id);
+
+DLLEXPORT void PlayerPreviousFrame(int32_t id);
+
+// Taps the decoded audio of the player from the next entry opened, which is
+// no longer played by the audio output unless |passthrough| is true.
+// |layout| is an |AudioTap::Layout|, |rate| is 0 to keep the rate of the
+// media, |channels| is clamped to [1, 8] & each ring holds |capacity|
+// frames. Fills at most |rings_size| elements of |rings| & returns the number
+// of rings, which exceeds |rings_size| if the tap already existed with more
+// channels. An "audioFormatEvent" is sent with the rate & channels whenever
+// a media is opened. The rings live as long as the player.
+DLLEXPORT int32_t PlayerEnableAudioTap(int32_t id, int32_t rate,
+                                       int32_t channels, int32_t layout,
+                                       int32_t capacity, bool passthrough,
+                                       struct DartAudioRing* rings,
+                                       int32_t rings_size);
+
+// Analyzes the played audio |frequency| times per second into |bands|
+// log-spaced bands in dBFS computed from the last |fft_size| frames, & per
+// channel RMS & peak levels. An "analysisEvent" is sent with each analysis.
+// Enables the audio tap with its passthrough if needed, or analyzes the tap
+// enabled before as is. 0 |bands| stops the analysis.
+DLLEXPORT void PlayerSetAnalysis(int32_t id, int32_t bands, int32_t fft_size,
+                                 int32_t frequency);
+
+// Copies the latest analysis into |bands|, |rms| & |peak|, which must have
+// room for |band_count| & 8 elements respectively. Returns the number of
+// channels copied, at most 8, 0 if nothing was analyzed yet.
+DLLEXPORT int32_t PlayerGetAnalysis(int32_t id, float* bands,
+                                    int32_t band_count, float* rms,
+                                    float* peak);
+
+// Normalizes the loudness of the entries to |target| LUFS. |mode| is a
+// |LoudnessMode|.
+DLLEXPORT void PlayerSetNormalization(int32_t id, int32_t mode,
+                                      double target);
+
+// Loops [|start|, |end|) microseconds of the current entry |count| times, 0
+// for ever. A "loopEvent" is sent on each iteration. An empty region clears
+// the loop.
+DLLEXPORT void PlayerSetLoopRegion(int32_t id, int64_t start, int64_t end,
+                                   int32_t count);
+
+// Records the input of the current entry into |directory| without opening
+// it again or transcoding it, remuxed to |mux|, e.g. "ts", "mkv" or "mp4".
+// A "recordingEvent" is sent with the path of the file when the recording
+// starts & stops, it stops with the entry.
+DLLEXPORT void PlayerStartRecording(int32_t id, const char* directory,
+                                    const char* mux);
+
+DLLEXPORT void PlayerStopRecording(int32_t id);
+
 DLLEXPORT void PlayerSetVolume(int32_t id, float volume);
 
 DLLEXPORT void PlayerSetRate(int32_t id, float rate);
@@ -78,6 +267,18 @@ DLLEXPORT void PlayerSetEqualizer(int32_t id, int32_t equalizer_id);
 
 DLLEXPORT void PlayerSetPlaylistMode(int32_t id, const char* mode);
 
+// Fades consecutive entries into each other over |duration| milliseconds,
+// 0 disables crossfades. |curve| is 0 for linear & 1 for equal power ramps.
+DLLEXPORT void PlayerSetCrossfade(int32_t id, int32_t duration, int32_t curve);
+
+// Plays the entries in an order generated from |seed| (0 for a random one),
+// without reordering the playlist.
+DLLEXPORT void PlayerSetShuffle(int32_t id, bool shuffle, int64_t seed);
+
+// Prepares the next entry |prefetch| milliseconds before the end of the
+// current one, 0 disables gapless playback.
+DLLEXPORT void PlayerSetGapless(int32_t id, int32_t prefetch);
+
 DLLEXPORT void PlayerAdd(int32_t id, const char* type, const char* resource);
 
 DLLEXPORT void PlayerRemove(int32_t id, int32_t index);
@@ -88,17 +289,86 @@ DLLEXPORT void PlayerInsert(int32_t id, int32_t index, const char* type,
 DLLEXPORT void PlayerMove(int32_t id, int32_t initial_index,
                           int32_t final_index);
 
+DLLEXPORT void PlayerApply(int32_t id,
+                           const struct DartPlaylistOperation* operations,
+                           int32_t operations_size, const char** source,
+                           int32_t source_size);
+
 DLLEXPORT const char** MediaParse(Dart_Handle object, const char* type,
                                   const char* resource, int32_t timeout);
 
+DLLEXPORT struct DartMediaMetas* MediaParseMetas(Dart_Handle object,
+                                                 const char* type,
+                                                 const char* resource,
+                                                 int32_t timeout,
+                                                 uint32_t mask, bool network);
+
+DLLEXPORT struct DartMediaTracksList* MediaParseTracks(Dart_Handle object,
+                                                      const char** source,
+                                                      int32_t source_size,
+                                                      int32_t timeout);
+
+DLLEXPORT void CacheSetDirectory(const char* directory);
+
+DLLEXPORT const char* ArtworkGet(Dart_Handle object, const char* type,
+                                 const char* resource, int32_t size);
+
+DLLEXPORT void ArtworkRequest(int32_t id, const char* type,
+                              const char* resource, int32_t size);
+
+DLLEXPORT struct DartThumbnailStrip* ThumbnailsGet(Dart_Handle object,
+                                                   const char* type,
+                                                   const char* resource,
+                                                   int32_t interval,
+                                                   int32_t width);
+
+// Generates a thumbnail every |interval| milliseconds, fitting |width| x
+// |width|. A "thumbnailsEvent" is sent once done. The sheets are cached
+// uncompressed, see |ThumbnailCache| for their size.
+DLLEXPORT void ThumbnailsRequest(int32_t id, const char* type,
+                                 const char* resource, int32_t interval,
+                                 int32_t width);
+
+DLLEXPORT struct DartWaveform* WaveformGet(Dart_Handle object,
+                                           const char* type,
+                                           const char* resource);
+
+// Decodes the audio of a media as fast as possible into its waveform. A
+// "waveformEvent" is sent once done.
+DLLEXPORT void WaveformRequest(int32_t id, const char* type,
+                               const char* resource);
+
+// Builds the keyframe index of a local MPEG-TS or AVI file, with which fast
+// seeks snap to the time of the preceding keyframe. A "keyframesEvent" is
+// sent once done.
+DLLEXPORT void KeyframesRequest(int32_t id, const char* type,
+                                const char* resource);
+
+// Measures the loudness of a local file following EBU R128. A
+// "loudnessEvent" is sent once done.
+DLLEXPORT void LoudnessRequest(int32_t id, const char* type,
+                               const char* resource);
+
 DLLEXPORT void BroadcastCreate(int32_t id, const char* type,
                                const char* resource, const char* access,
                                const char* mux, const char* dst,
                                const char* vcodec, int32_t vb,
                                const char* acodec, int32_t ab);
 
+// Creates a broadcast demuxing its input once for all |outputs|. Outputs
+// with the same codecs & bitrates share a single encode, empty codecs pass
+// the streams through.
+DLLEXPORT void BroadcastCreateOutputs(
+    int32_t id, const char* type, const char* resource,
+    const struct DartBroadcastOutput* outputs, int32_t outputs_size);
+
+// A "broadcastEvent" is sent on each change of |StreamOutputJob::State|,
+// including failures to start.
 DLLEXPORT void BroadcastStart(int32_t id);
 
+// Fills |stats|, the bytes are only reported for the file access.
+DLLEXPORT void BroadcastGetStats(int32_t id, struct DartJobStats* stats);
+
 DLLEXPORT void BroadcastDispose(int32_t id);
 
 DLLEXPORT void ChromecastCreate(int32_t id, const char* type,
@@ -111,12 +381,59 @@ DLLEXPORT void ChromecastDispose(int32_t id);
 DLLEXPORT void RecordCreate(int32_t id, const char* saving_file,
                             const char* type, const char* resource);
 
+// Records into |directory| as |segment_duration| seconds MPEG-TS segments,
+// deleting those older than |max_age| seconds or beyond |max_bytes| in
+// total, 0 for no limit. The segments are indexed by wall clock time in
+// index.txt, see |SegmentJanitor|.
+DLLEXPORT void RecordCreateSegmented(int32_t id, const char* directory,
+                                     const char* type, const char* resource,
+                                     int32_t segment_duration,
+                                     int64_t max_age, int64_t max_bytes);
+
+// Returns the segment recorded at |time| milliseconds since the epoch & sets
+// |offset| to the milliseconds of |time| in it. Empty if there is none.
+DLLEXPORT const char* RecordFindSegment(Dart_Handle object, int32_t id,
+                                        int64_t time, int64_t* offset);
+
+// Keeps the last |preroll| seconds of the stream in memory, at most
+// |max_bytes|, 0 for no limit, without writing anything until |RecordTrigger|
+// is called.
+// Clips are written to |directory| without transcoding.
+DLLEXPORT void RecordCreatePreroll(int32_t id, const char* directory,
+                                   const char* type, const char* resource,
+                                   int32_t preroll, int64_t max_bytes);
+
+// Writes a clip of the pre-roll followed by the next |post_seconds|, or
+// extends the clip being written. A "recordClipEvent" is sent with its path
+// once complete.
+DLLEXPORT void RecordTrigger(int32_t id, int32_t post_seconds);
+
+// A "recordEvent" is sent on each change of |StreamOutputJob::State|,
+// including failures to start.
 DLLEXPORT void RecordStart(int32_t id);
 
+DLLEXPORT void RecordGetStats(int32_t id, struct DartJobStats* stats);
+
 DLLEXPORT void RecordDispose(int32_t id);
 
+// The parsed metadata & the index of a library are stored in the cache, so
+// returns false without creating the library if |CacheSetDirectory| was not
+// called.
+DLLEXPORT bool LibraryCreate(int32_t id, const char** directories,
+                             int32_t directories_size, const char** extensions,
+                             int32_t extensions_size, bool sniff);
+
+DLLEXPORT void LibraryScan(int32_t id, bool watch);
+
+DLLEXPORT void LibraryDispose(int32_t id);
+
+// Returns the cached list of audio output devices.
 DLLEXPORT DartDeviceList* DevicesAll(Dart_Handle object);
 
+// Refreshes the list of devices in the background, sending a "devicesEvent"
+// with |id| whenever it changes.
+DLLEXPORT void DevicesWatch(int32_t id);
+
 DLLEXPORT struct DartEqualizer* EqualizerCreateEmpty(Dart_Handle object);
 
 DLLEXPORT struct DartEqualizer* EqualizerCreateMode(Dart_Handle object,
@@ -12,6 +12,9 @@
 #ifndef API_EVENTMANAGER_H_
 #define API_EVENTMANAGER_H_
 
+#include <algorithm>
+#include <memory>
+
 #include "base.h"
 #include "player.h"
 #include "api/dartmanager.h"
@@ -158,11 +161,20 @@ inline void OnRate(int32_t id, PlayerState* state) {
   g_dart_post_C_object(g_callback_port, &return_object);
 }
 
+// Sends the index & the number of entries, followed by the entries in the
+// range [start, end) modified since the previous event, so that track changes
+// of large playlists do not send them again. Called with the playlist locked.
 inline void OnOpen(int32_t id, PlayerState* state) {
-  const auto& media_items = state->medias()->medias();
+  const PlaylistEntries* media_items = state->medias();
+  int32_t size = static_cast<int32_t>(media_items->size());
+  int32_t end = std::min(state->changed_end(), size);
+  int32_t start = std::min(state->changed_start(), end);
+  size_t count = end - start;
 
-  auto value_objects = std::unique_ptr<Dart_CObject* []>(
-      new Dart_CObject*[4 + media_items.size() * 2]);
+  auto value_objects =
+      std::unique_ptr<Dart_CObject* []>(new Dart_CObject*[6 + count * 2]);
+  auto media_objects =
+      std::unique_ptr<Dart_CObject[]>(new Dart_CObject[count * 2]);
 
   Dart_CObject id_object;
   id_object.type = Dart_CObject_kInt32;
@@ -184,23 +196,33 @@ inline void OnOpen(int32_t id, PlayerState* state) {
   is_playlist_object.value.as_int32 = state->is_playlist();
   value_objects[3] = &is_playlist_object;
 
-  for (int32_t i = 0; i < media_items.size(); i += 2) {
-    Dart_CObject media_type_object;
+  Dart_CObject size_object;
+  size_object.type = Dart_CObject_kInt32;
+  size_object.value.as_int32 = size;
+  value_objects[4] = &size_object;
+
+  Dart_CObject start_object;
+  start_object.type = Dart_CObject_kInt32;
+  start_object.value.as_int32 = start;
+  value_objects[5] = &start_object;
+
+  for (size_t i = 0; i < count; i++) {
+    Dart_CObject& media_type_object = media_objects[i * 2];
     media_type_object.type = Dart_CObject_kString;
     media_type_object.value.as_string =
-        const_cast<char*>(media_items[i]->media_type().c_str());
+        const_cast<char*>(media_items->media_type(start + i));
 
-    Dart_CObject resource_object;
+    Dart_CObject& resource_object = media_objects[i * 2 + 1];
     resource_object.type = Dart_CObject_kString;
     resource_object.value.as_string =
-        const_cast<char*>(media_items[i]->resource().c_str());
-    value_objects[i + 4] = &media_type_object;
-    value_objects[i + 5] = &resource_object;
+        const_cast<char*>(media_items->resource(start + i));
+    value_objects[i * 2 + 6] = &media_type_object;
+    value_objects[i * 2 + 7] = &resource_object;
   }
 
   Dart_CObject return_object;
   return_object.type = Dart_CObject_kArray;
-  return_object.value.as_array.length = 4 + media_items.size() * 2;
+  return_object.value.as_array.length = 6 + count * 2;
   return_object.value.as_array.values = value_objects.get();
   g_dart_post_C_object(g_callback_port, &return_object);
 }
@@ -257,6 +279,459 @@ inline void OnVideo(int32_t id, int size, uint8_t* frame) {
   g_dart_post_C_object(g_callback_port, &return_object);
 }
 
+inline void OnGapless(int32_t id, int32_t index, int64_t gap) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "gaplessEvent";
+
+  Dart_CObject index_object;
+  index_object.type = Dart_CObject_kInt32;
+  index_object.value.as_int32 = index;
+
+  Dart_CObject gap_object;
+  gap_object.type = Dart_CObject_kInt64;
+  gap_object.value.as_int64 = gap;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &index_object,
+                                   &gap_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 4;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnLoop(int32_t id, int32_t iteration) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "loopEvent";
+
+  Dart_CObject iteration_object;
+  iteration_object.type = Dart_CObject_kInt32;
+  iteration_object.value.as_int32 = iteration;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object,
+                                   &iteration_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 3;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnAudioFormat(int32_t id, int32_t rate, int32_t channels) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "audioFormatEvent";
+
+  Dart_CObject rate_object;
+  rate_object.type = Dart_CObject_kInt32;
+  rate_object.value.as_int32 = rate;
+
+  Dart_CObject channels_object;
+  channels_object.type = Dart_CObject_kInt32;
+  channels_object.value.as_int32 = channels;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &rate_object,
+                                   &channels_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 4;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnAnalysis(int32_t id, const float* bands, int32_t band_count,
+                       const float* rms, const float* peak,
+                       int32_t channels) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "analysisEvent";
+
+  Dart_CObject bands_object;
+  bands_object.type = Dart_CObject_kTypedData;
+  bands_object.value.as_typed_data.type = Dart_TypedData_kFloat32;
+  bands_object.value.as_typed_data.values =
+      reinterpret_cast<const uint8_t*>(bands);
+  bands_object.value.as_typed_data.length = band_count;
+
+  Dart_CObject rms_object;
+  rms_object.type = Dart_CObject_kTypedData;
+  rms_object.value.as_typed_data.type = Dart_TypedData_kFloat32;
+  rms_object.value.as_typed_data.values =
+      reinterpret_cast<const uint8_t*>(rms);
+  rms_object.value.as_typed_data.length = channels;
+
+  Dart_CObject peak_object;
+  peak_object.type = Dart_CObject_kTypedData;
+  peak_object.value.as_typed_data.type = Dart_TypedData_kFloat32;
+  peak_object.value.as_typed_data.values =
+      reinterpret_cast<const uint8_t*>(peak);
+  peak_object.value.as_typed_data.length = channels;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &bands_object,
+                                   &rms_object, &peak_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 5;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnRecording(int32_t id, bool is_recording,
+                        const std::string& path) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "recordingEvent";
+
+  Dart_CObject is_recording_object;
+  is_recording_object.type = Dart_CObject_kBool;
+  is_recording_object.value.as_bool = is_recording;
+
+  Dart_CObject path_object;
+  path_object.type = Dart_CObject_kString;
+  path_object.value.as_string = const_cast<char*>(path.c_str());
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object,
+                                   &is_recording_object, &path_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 4;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnSeek(int32_t id, int64_t target, int64_t time, int64_t latency,
+                   int32_t dropped) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "seekEvent";
+
+  Dart_CObject target_object;
+  target_object.type = Dart_CObject_kInt64;
+  target_object.value.as_int64 = target;
+
+  Dart_CObject time_object;
+  time_object.type = Dart_CObject_kInt64;
+  time_object.value.as_int64 = time;
+
+  Dart_CObject latency_object;
+  latency_object.type = Dart_CObject_kInt64;
+  latency_object.value.as_int64 = latency;
+
+  Dart_CObject dropped_object;
+  dropped_object.type = Dart_CObject_kInt32;
+  dropped_object.value.as_int32 = dropped;
+
+  Dart_CObject* value_objects[] = {&id_object,      &type_object,
+                                   &target_object,  &time_object,
+                                   &latency_object, &dropped_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 6;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnLibraryProgress(int32_t id, int32_t scanned, int32_t parsed,
+                              bool completed) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "libraryProgressEvent";
+
+  Dart_CObject scanned_object;
+  scanned_object.type = Dart_CObject_kInt32;
+  scanned_object.value.as_int32 = scanned;
+
+  Dart_CObject parsed_object;
+  parsed_object.type = Dart_CObject_kInt32;
+  parsed_object.value.as_int32 = parsed;
+
+  Dart_CObject completed_object;
+  completed_object.type = Dart_CObject_kBool;
+  completed_object.value.as_bool = completed;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &scanned_object,
+                                   &parsed_object, &completed_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 5;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnLibraryChange(int32_t id, const char* change,
+                            const std::string& path) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "libraryChangeEvent";
+
+  Dart_CObject change_object;
+  change_object.type = Dart_CObject_kString;
+  change_object.value.as_string = const_cast<char*>(change);
+
+  Dart_CObject path_object;
+  path_object.type = Dart_CObject_kString;
+  path_object.value.as_string = const_cast<char*>(path.c_str());
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &change_object,
+                                   &path_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 4;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnArtwork(int32_t id, const std::string& path) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "artworkEvent";
+
+  Dart_CObject path_object;
+  path_object.type = Dart_CObject_kString;
+  path_object.value.as_string = const_cast<char*>(path.c_str());
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &path_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 3;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnThumbnails(int32_t id, int32_t count) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "thumbnailsEvent";
+
+  Dart_CObject count_object;
+  count_object.type = Dart_CObject_kInt32;
+  count_object.value.as_int32 = count;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &count_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 3;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnWaveform(int32_t id, int64_t frames) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "waveformEvent";
+
+  Dart_CObject frames_object;
+  frames_object.type = Dart_CObject_kInt64;
+  frames_object.value.as_int64 = frames;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &frames_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 3;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnDevices(int32_t id, int32_t count) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "devicesEvent";
+
+  Dart_CObject count_object;
+  count_object.type = Dart_CObject_kInt32;
+  count_object.value.as_int32 = count;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &count_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 3;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnKeyframes(int32_t id, int32_t count) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "keyframesEvent";
+
+  Dart_CObject count_object;
+  count_object.type = Dart_CObject_kInt32;
+  count_object.value.as_int32 = count;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &count_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 3;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnLoudness(int32_t id, double integrated, double range,
+                       double true_peak) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "loudnessEvent";
+
+  Dart_CObject integrated_object;
+  integrated_object.type = Dart_CObject_kDouble;
+  integrated_object.value.as_double = integrated;
+
+  Dart_CObject range_object;
+  range_object.type = Dart_CObject_kDouble;
+  range_object.value.as_double = range;
+
+  Dart_CObject true_peak_object;
+  true_peak_object.type = Dart_CObject_kDouble;
+  true_peak_object.value.as_double = true_peak;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object,
+                                   &integrated_object, &range_object,
+                                   &true_peak_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 5;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnBroadcast(int32_t id, int32_t state) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "broadcastEvent";
+
+  Dart_CObject state_object;
+  state_object.type = Dart_CObject_kInt32;
+  state_object.value.as_int32 = state;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &state_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 3;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnRecord(int32_t id, int32_t state) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "recordEvent";
+
+  Dart_CObject state_object;
+  state_object.type = Dart_CObject_kInt32;
+  state_object.value.as_int32 = state;
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &state_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 3;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
+inline void OnRecordClip(int32_t id, const std::string& path) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt32;
+  id_object.value.as_int32 = id;
+
+  Dart_CObject type_object;
+  type_object.type = Dart_CObject_kString;
+  type_object.value.as_string = "recordClipEvent";
+
+  Dart_CObject path_object;
+  path_object.type = Dart_CObject_kString;
+  path_object.value.as_string = const_cast<char*>(path.c_str());
+
+  Dart_CObject* value_objects[] = {&id_object, &type_object, &path_object};
+
+  Dart_CObject return_object;
+  return_object.type = Dart_CObject_kArray;
+  return_object.value.as_array.length = 3;
+  return_object.value.as_array.values = value_objects;
+  g_dart_post_C_object(g_callback_port, &return_object);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,168 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef ARTWORK_H_
+#define ARTWORK_H_
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "cache.h"
+#include "internal/framegrabber.h"
+#include "internal/threadpool.h"
+#include "mediasource/media.h"
+
+// Content-addressed cache of artworks embedded in medias. The original image
+// is stored once per distinct content (so tracks of an album share it) along
+// with pre-resized variants, which are what lists should display.
+class ArtworkCache {
+ public:
+  static constexpr int32_t kSizes[] = {64, 256, 512};
+
+  // Called with the variant's path (empty if the media has no artwork).
+  typedef std::function<void(const std::string& path)> Callback;
+
+  // Returns the path of the cached variant of |media|'s artwork closest to
+  // |size| without touching the media itself, or an empty string if it has
+  // not been extracted yet.
+  std::string Get(std::shared_ptr<Media> media, int32_t size) {
+    std::optional<Reference> reference = ReadReference(media);
+    if (!reference) return "";
+    auto path = VariantPath(reference->hash, size);
+    std::error_code error;
+    return std::filesystem::exists(path, error) ? path.u8string() : "";
+  }
+
+  // Extracts the artwork of |media| & resizes it in the background if it is
+  // not cached yet. |callback| is invoked on a worker thread.
+  void Request(std::shared_ptr<Media> media, int32_t size, Callback callback) {
+    pool_.Post([=]() -> void {
+      std::optional<Reference> reference = ReadReference(media);
+      if (!reference) reference = Extract(media);
+      if (!reference) {
+        callback("");
+        return;
+      }
+      auto path = VariantPath(reference->hash, size);
+      std::error_code error;
+      if (!std::filesystem::exists(path, error)) Resize(*reference, size);
+      callback(std::filesystem::exists(path, error) ? path.u8string() : "");
+    });
+  }
+
+ private:
+  // Identifies the original artwork of a media inside the cache.
+  struct Reference {
+    std::string hash;
+    std::string extension;
+  };
+
+  static constexpr auto kReferenceExtension = ".artref";
+  static constexpr int32_t kParseTimeout = 10000;
+
+  static int32_t VariantSize(int32_t size) {
+    for (int32_t variant : kSizes) {
+      if (variant >= size) return variant;
+    }
+    return kSizes[sizeof(kSizes) / sizeof(kSizes[0]) - 1];
+  }
+
+  std::filesystem::path VariantPath(const std::string& hash, int32_t size) {
+    return g_cache->Path(hash,
+                         "-" + std::to_string(VariantSize(size)) + ".bmp");
+  }
+
+  // Returns |media|'s artwork if it was extracted before.
+  std::optional<Reference> ReadReference(std::shared_ptr<Media> media) {
+    if (!g_cache->enabled()) return std::nullopt;
+    std::optional<CacheRecord> record =
+        g_cache->Read(media->cache_key(), kReferenceExtension);
+    Reference reference;
+    if (!record || !record->Get(reference.hash) ||
+        !record->Get(reference.extension)) {
+      return std::nullopt;
+    }
+    return reference;
+  }
+
+  // Copies the artwork of |media| into the cache. Only artworks libVLC
+  // exposes as local files can be extracted, embedded covers are fetched to
+  // its own art cache first.
+  std::optional<Reference> Extract(std::shared_ptr<Media> media) {
+    if (!g_cache->enabled()) return std::nullopt;
+    media->parse(kParseTimeout, 1u << Media::kMetaArtworkUrl, false, true);
+    std::string url = media->metas()["artworkUrl"];
+    static constexpr auto kFileScheme = "file://";
+    if (url.compare(0, strlen(kFileScheme), kFileScheme) != 0) {
+      return std::nullopt;
+    }
+    std::filesystem::path source =
+        std::filesystem::u8path(PathFromUrl(url.substr(strlen(kFileScheme))));
+    std::ifstream file(source, std::ios::binary);
+    if (!file) return std::nullopt;
+    std::stringstream data;
+    data << file.rdbuf();
+    Reference reference{Cache::Hash(data.str()),
+                        source.extension().u8string()};
+    if (!g_cache->Contains(reference.hash, reference.extension)) {
+      Cache::WriteFile(g_cache->Path(reference.hash, reference.extension),
+                       data.str());
+    }
+    CacheRecord record;
+    record.Put(reference.hash);
+    record.Put(reference.extension);
+    g_cache->Write(media->cache_key(), kReferenceExtension, record);
+    return reference;
+  }
+
+  // Produces the variant of |reference| matching |size|.
+  void Resize(const Reference& reference, int32_t size) {
+    auto original = g_cache->Path(reference.hash, reference.extension);
+    int32_t variant = VariantSize(size);
+    FrameGrabber grabber("file:///" + original.generic_u8string(), variant,
+                         variant, {":no-audio"});
+    if (grabber.Grab()) grabber.Save(VariantPath(reference.hash, size));
+  }
+
+  // Decodes the percent-encoded path of a `file://` URL.
+  static std::string PathFromUrl(const std::string& url) {
+    std::string result;
+    for (size_t i = 0; i < url.size(); i++) {
+      if (url[i] == '%' && i + 2 < url.size()) {
+        result += static_cast<char>(
+            std::strtol(url.substr(i + 1, 2).c_str(), nullptr, 16));
+        i += 2;
+      } else {
+        result += url[i];
+      }
+    }
+#ifdef _WIN32
+    // file:///C:/... yields /C:/...
+    if (result.size() > 2 && result[0] == '/' && result[2] == ':') {
+      result.erase(0, 1);
+    }
+#endif
+    return result;
+  }
+
+  // Decoding images is cheap, but each one spawns a libVLC pipeline.
+  ThreadPool pool_{2};
+};
+
+extern std::unique_ptr<ArtworkCache> g_artwork_cache;
+
+#endif
@@ -12,16 +12,22 @@
 #ifndef BROADCAST_H_
 #define BROADCAST_H_
 
+#include <algorithm>
+#include <filesystem>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "mediasource/media.h"
+#include "streamoutput.h"
 
-class BroadcastConfiguration {
+// Destination of a broadcast. Empty codecs pass the elementary streams
+// through without transcoding.
+class BroadcastOutput {
  public:
-  BroadcastConfiguration(std::string access, std::string mux, std::string dst,
-                         std::string vcodec, int32_t vb, std::string acodec,
-                         int32_t ab)
+  BroadcastOutput(std::string access, std::string mux, std::string dst,
+                  std::string vcodec, int32_t vb, std::string acodec,
+                  int32_t ab)
       : access_(access),
         mux_(mux),
         dst_(dst),
@@ -38,16 +44,106 @@ class BroadcastConfiguration {
   int32_t vb() const { return vb_; }
   int32_t ab() const { return ab_; }
 
+  // Outputs with the same encoding share a single transcode.
+  bool SharesEncoding(const BroadcastOutput& other) const {
+    return vcodec_ == other.vcodec_ && vb_ == other.vb_ &&
+           acodec_ == other.acodec_ && ab_ == other.ab_;
+  }
+
  private:
-  const std::string access_;
-  const std::string mux_;
-  const std::string dst_;
-  const std::string vcodec_;
-  const std::string acodec_;
+  std::string access_;
+  std::string mux_;
+  std::string dst_;
+  std::string vcodec_;
+  std::string acodec_;
   int32_t vb_;
   int32_t ab_;
 };
 
+// Outputs of a broadcast, all fed by a single demux of the input.
+class BroadcastConfiguration {
+ public:
+  BroadcastConfiguration(std::string access, std::string mux, std::string dst,
+                         std::string vcodec, int32_t vb, std::string acodec,
+                         int32_t ab)
+      : outputs_{BroadcastOutput(access, mux, dst, vcodec, vb, acodec, ab)} {}
+
+  explicit BroadcastConfiguration(std::vector<BroadcastOutput> outputs)
+      : outputs_(outputs) {}
+
+  const std::vector<BroadcastOutput>& outputs() const { return outputs_; }
+
+  // Builds the sout chain, e.g. for two outputs sharing an encode & a
+  // pass-through one:
+  // #duplicate{dst=transcode{...}:duplicate{dst=std{...},dst=std{...}},
+  //            dst=std{...}}
+  std::string Sout() const {
+    std::vector<std::vector<const BroadcastOutput*>> groups;
+    for (const BroadcastOutput& output : outputs_) {
+      auto group = std::find_if(
+          groups.begin(), groups.end(),
+          [&](const std::vector<const BroadcastOutput*>& group) -> bool {
+            return group.front()->SharesEncoding(output);
+          });
+      if (group == groups.end()) {
+        groups.push_back({&output});
+      } else {
+        group->emplace_back(&output);
+      }
+    }
+    std::vector<std::string> branches;
+    for (const std::vector<const BroadcastOutput*>& group : groups) {
+      std::vector<std::string> destinations;
+      for (const BroadcastOutput* output : group) {
+        destinations.emplace_back(Destination(*output));
+      }
+      branches.emplace_back(Encoding(*group.front()) +
+                            Duplicate(destinations));
+    }
+    return "#" + Duplicate(branches);
+  }
+
+ private:
+  static std::string Destination(const BroadcastOutput& output) {
+    std::stringstream destination;
+    destination << "std{access=" << output.access()
+                << ", mux=" << output.mux()
+                << ", dst=" << StreamOutputHost::Quote(output.dst()) << "}";
+    return destination.str();
+  }
+
+  // Transcode module followed by ':', empty for pass-through.
+  static std::string Encoding(const BroadcastOutput& output) {
+    if (output.vcodec().empty() && output.acodec().empty()) return "";
+    std::stringstream encoding;
+    std::string separator = "";
+    encoding << "transcode{";
+    if (!output.vcodec().empty()) {
+      encoding << "vcodec=" << output.vcodec();
+      if (output.vb() > 0) encoding << ", vb=" << output.vb();
+      separator = ", ";
+    }
+    if (!output.acodec().empty()) {
+      encoding << separator << "acodec=" << output.acodec();
+      if (output.ab() > 0) encoding << ", ab=" << output.ab();
+    }
+    encoding << "}:";
+    return encoding.str();
+  }
+
+  static std::string Duplicate(const std::vector<std::string>& chains) {
+    if (chains.size() == 1) return chains.front();
+    std::string duplicate = "duplicate{";
+    for (size_t index = 0; index < chains.size(); index++) {
+      if (index > 0) duplicate += ", ";
+      duplicate += "dst=" + chains[index];
+    }
+    return duplicate + "}";
+  }
+
+  std::vector<BroadcastOutput> outputs_;
+};
+
 class Broadcast {
  public:
   Broadcast(std::shared_ptr<Media> media,
@@ -55,26 +151,35 @@ class Broadcast {
       : media_(media), configuration_(std::move(configuration)) {}
 
   void Start() {
-    std::stringstream sout;
-    sout << "#transcode{vcodec=" << configuration_->vcodec()
-         << ", vb=" << configuration_->vb()
-         << ", acodec=" << configuration_->acodec()
-         << ", ab=" << configuration_->ab()
-         << "}:std{access=" << configuration_->access()
-         << ", mux=" << configuration_->mux()
-         << ", dst=" << configuration_->dst();
-    libvlc_vlm_add_broadcast(vlc_instance_.get(), media_->location().c_str(),
-                             media_->location().c_str(), sout.str().c_str(), 0,
-                             nullptr, true, false);
-    libvlc_vlm_play_media(vlc_instance_.get(), media_->location().c_str());
+    if (!job_) {
+      job_ = g_stream_output_host->Create(media_->location(),
+                                          configuration_->Sout());
+      job_->OnState(state_callback_);
+      for (const BroadcastOutput& output : configuration_->outputs()) {
+        if (output.access() == "file") {
+          job_->SetOutputFile(std::filesystem::u8path(output.dst()));
+          break;
+        }
+      }
+    }
+    job_->Play();
+  }
+
+  // Bytes are only reported for the first output with the file access.
+  StreamOutputJob::Stats stats() {
+    if (job_) return job_->stats();
+    return StreamOutputJob::IdleStats();
   }
 
-  ~Broadcast() { libvlc_vlm_release(vlc_instance_.get()); }
+  void OnState(StreamOutputJob::Callback callback) {
+    state_callback_ = callback;
+  }
 
  private:
-  VLC::Instance vlc_instance_ = VLC::Instance(0, nullptr);
   std::shared_ptr<Media> media_;
   std::unique_ptr<BroadcastConfiguration> configuration_;
+  std::unique_ptr<StreamOutputJob> job_;
+  StreamOutputJob::Callback state_callback_;
 };
 
 class Broadcasts {
@@ -0,0 +1,204 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+// Binary record stored inside the cache. Values are written & read back in
+// the same order, integers in host byte order.
+class CacheRecord {
+ public:
+  CacheRecord() = default;
+  explicit CacheRecord(std::string data) : data_(std::move(data)) {}
+
+  const std::string& data() const { return data_; }
+
+  template <typename T>
+  void Put(T value) {
+    static_assert(std::is_arithmetic_v<T>);
+    data_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void Put(const std::string& value) {
+    Put(static_cast<uint32_t>(value.size()));
+    data_.append(value);
+  }
+
+  void Put(const void* data, size_t size) {
+    data_.append(static_cast<const char*>(data), size);
+  }
+
+  template <typename T>
+  bool Get(T& value) {
+    static_assert(std::is_arithmetic_v<T>);
+    if (offset_ + sizeof(T) > data_.size()) return false;
+    memcpy(&value, data_.data() + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+
+  bool Get(std::string& value) {
+    uint32_t size = 0;
+    if (!Get(size) || offset_ + size > data_.size()) return false;
+    value.assign(data_, offset_, size);
+    offset_ += size;
+    return true;
+  }
+
+  bool Get(void* data, size_t size) {
+    if (offset_ + size > data_.size()) return false;
+    memcpy(data, data_.data() + offset_, size);
+    offset_ += size;
+    return true;
+  }
+
+ private:
+  std::string data_;
+  size_t offset_ = 0;
+};
+
+// On-disk cache for data derived from medias (metadata, tracks etc.). Entries
+// are files named after a key & an extension identifying the kind of data.
+// Caching is disabled until a directory is set.
+class Cache {
+ public:
+  static constexpr uint32_t kVersion = 1;
+
+  void SetDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = std::filesystem::u8path(directory);
+    std::error_code error;
+    if (!directory_.empty()) {
+      std::filesystem::create_directories(directory_, error);
+    }
+  }
+
+  bool enabled() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !directory_.empty();
+  }
+
+  // Returns the key for the media at |location|. Local files are keyed by
+  // their path, size & modification time so that stale entries are never
+  // served after a file changes.
+  static std::string Key(const std::string& location,
+                         const std::string& path = "") {
+    std::stringstream identity;
+    identity << location;
+    if (!path.empty()) {
+      std::error_code error;
+      auto file = std::filesystem::u8path(path);
+      auto size = std::filesystem::file_size(file, error);
+      if (!error) identity << '\0' << size;
+      auto time = std::filesystem::last_write_time(file, error);
+      if (!error) identity << '\0' << time.time_since_epoch().count();
+    }
+    return Hash(identity.str());
+  }
+
+  // 64-bit FNV-1a, hex-encoded.
+  static std::string Hash(const void* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ull;
+    }
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx",
+             static_cast<unsigned long long>(hash));
+    return buffer;
+  }
+
+  static std::string Hash(const std::string& value) {
+    return Hash(value.data(), value.size());
+  }
+
+  std::filesystem::path Path(const std::string& key,
+                             const std::string& extension) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (directory_.empty()) return {};
+    return directory_ / (key + extension);
+  }
+
+  bool Contains(const std::string& key, const std::string& extension) {
+    auto path = Path(key, extension);
+    std::error_code error;
+    return !path.empty() && std::filesystem::exists(path, error);
+  }
+
+  std::optional<CacheRecord> Read(const std::string& key,
+                                  const std::string& extension) {
+    auto path = Path(key, extension);
+    if (path.empty()) return std::nullopt;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return std::nullopt;
+    std::stringstream data;
+    data << file.rdbuf();
+    CacheRecord record(data.str());
+    uint32_t version = 0;
+    if (!record.Get(version) || version != kVersion) return std::nullopt;
+    return record;
+  }
+
+  bool Write(const std::string& key, const std::string& extension,
+             const CacheRecord& record) {
+    CacheRecord versioned;
+    versioned.Put(kVersion);
+    versioned.Put(record.data().data(), record.data().size());
+    return WriteFile(Path(key, extension), versioned.data());
+  }
+
+  // Writes |data| to a temporary file & renames it over |path|, so readers
+  // never observe a partially written entry.
+  static bool WriteFile(const std::filesystem::path& path,
+                        const std::string& data) {
+    if (path.empty()) return false;
+    static std::atomic<uint32_t> counter = 0;
+    auto temporary = path;
+    temporary += ".tmp" + std::to_string(counter++);
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      if (!file) return false;
+      file.write(data.data(), data.size());
+      if (!file) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+      std::error_code ignored;
+      std::filesystem::remove(temporary, ignored);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::filesystem::path directory_;
+};
+
+extern std::unique_ptr<Cache> g_cache;
+
+#endif
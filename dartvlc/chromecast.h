@@ -12,10 +12,12 @@
 #ifndef CHROMECAST_H_
 #define CHROMECAST_H_
 
+#include <memory>
 #include <sstream>
 #include <string>
 
 #include "mediasource/media.h"
+#include "streamoutput.h"
 
 class Chromecast {
  public:
@@ -26,18 +28,16 @@ class Chromecast {
     std::stringstream sout;
     sout << "#chromecast{ip=" << this->ip_address_
          << ", demux-filter=demux_chromecast, conversion-quality=0}";
-    libvlc_vlm_add_broadcast(vlc_instance_.get(), media_->location().c_str(),
-                             media_->location().c_str(), sout.str().c_str(), 0,
-                             nullptr, true, false);
-    libvlc_vlm_play_media(vlc_instance_.get(), media_->location().c_str());
+    if (!job_) {
+      job_ = g_stream_output_host->Create(media_->location(), sout.str());
+    }
+    job_->Play();
   }
 
-  ~Chromecast() { libvlc_vlm_release(vlc_instance_.get()); }
-
  private:
-  std::string ip_address_;
-  VLC::Instance vlc_instance_ = VLC::Instance(0, nullptr);
   std::shared_ptr<Media> media_;
+  std::string ip_address_;
+  std::unique_ptr<StreamOutputJob> job_;
 };
 
 class Chromecasts {
@@ -57,6 +57,6 @@ class Chromecasts {
   std::map<int32_t, std::unique_ptr<Chromecast>> chromecasts_;
 };
 
-Chromecasts* chromecasts = new Chromecasts();
+extern std::unique_ptr<Chromecasts> g_chromecasts;
 
-#endif
\ No newline at end of file
+#endif
@@ -12,10 +12,23 @@
 #ifndef DEVICE_H_
 #define DEVICE_H_
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <vlcpp/vlc.hpp>
 
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 class Device {
  public:
   const std::string& id() const { return id_; }
@@ -35,22 +48,159 @@ class Device {
   std::string name_;
 };
 
+// Keeps the list of audio output devices, enumerated through a long-lived
+// libVLC instance. Once |Watch| is called, the list is refreshed in the
+// background: every |kRefreshInterval|, & on Linux as soon as sound cards
+// are added or removed under /dev/snd.
 class Devices {
  public:
-  static std::vector<Device> All() {
+  // Called on the watcher's thread whenever the list changed.
+  typedef std::function<void(const std::vector<Device>&)> ChangeCallback;
+
+  ~Devices() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = true;
+    }
+    condition_.notify_all();
+    if (watch_thread_.joinable()) watch_thread_.join();
+  }
+
+  // Returns the cached list, enumerating the devices on the first call.
+  std::vector<Device> All() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (is_enumerated_) return devices_;
+    }
+    Refresh(false);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return devices_;
+  }
+
+  // Starts refreshing the list in the background, |callback| replaces the
+  // previous one.
+  void Watch(ChangeCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    change_callback_ = callback;
+    if (!watch_thread_.joinable()) {
+      watch_thread_ = std::thread(&Devices::Run, this);
+    }
+  }
+
+ private:
+  static constexpr auto kRefreshInterval = std::chrono::seconds(5);
+
+  // Must be called with |vlc_mutex_| held. Audio outputs such as PulseAudio,
+  // WASAPI or CoreAudio keep their list up to date, ALSA only enumerates when
+  // opened, so the player is recreated if |reopen| is true.
+  std::vector<Device> Enumerate(bool reopen) {
+    if (!vlc_instance_) {
+      static const char* kArguments[] = {"--no-video"};
+      vlc_instance_ = std::make_unique<VLC::Instance>(
+          sizeof(kArguments) / sizeof(kArguments[0]), kArguments);
+    }
+    if (!vlc_media_player_ || reopen) {
+      vlc_media_player_ = std::make_unique<VLC::MediaPlayer>(*vlc_instance_);
+    }
     std::vector<Device> devices{};
-    VLC::Instance vlc_instance = VLC::Instance(0, nullptr);
-    VLC::MediaPlayer vlc_media_player = VLC::MediaPlayer(vlc_instance);
-    std::vector<VLC::AudioOutputDeviceDescription> vlc_devices =
-        vlc_media_player.outputDeviceEnum();
-    for (VLC::AudioOutputDeviceDescription vlc_device : vlc_devices) {
+    for (const VLC::AudioOutputDeviceDescription& vlc_device :
+         vlc_media_player_->outputDeviceEnum()) {
       devices.emplace_back(
           Device(vlc_device.device(), vlc_device.description()));
     }
     return devices;
   }
 
- private:
+  // The cached list stays readable while the devices are enumerated.
+  void Refresh(bool reopen) {
+    std::lock_guard<std::mutex> vlc_lock(vlc_mutex_);
+    std::vector<Device> devices = Enumerate(reopen);
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool is_changed =
+        !is_enumerated_ || devices.size() != devices_.size() ||
+        !std::equal(devices.begin(), devices.end(), devices_.begin(),
+                    [](const Device& a, const Device& b) -> bool {
+                      return a.id() == b.id() && a.name() == b.name();
+                    });
+    devices_ = devices;
+    is_enumerated_ = true;
+    ChangeCallback callback = change_callback_;
+    lock.unlock();
+    if (is_changed) callback(devices);
+  }
+
+#ifdef __linux__
+  void Run() {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0 && inotify_add_watch(fd, "/dev/snd",
+                                     IN_CREATE | IN_DELETE | IN_ATTRIB) < 0) {
+      close(fd);
+      fd = -1;
+    }
+    alignas(struct inotify_event) char buffer[4 * 1024];
+    auto next = std::chrono::steady_clock::now() + kRefreshInterval;
+    while (!IsStopped()) {
+      if (fd < 0) {
+        Wait(next);
+      } else {
+        pollfd descriptor{fd, POLLIN, 0};
+        if (poll(&descriptor, 1, 250) > 0) {
+          // Device nodes come in bursts, the list is read once they settle.
+          while (read(fd, buffer, sizeof(buffer)) > 0 ||
+                 poll(&descriptor, 1, kSettleTime) > 0) {
+          }
+          Refresh(true);
+          next = std::chrono::steady_clock::now() + kRefreshInterval;
+          continue;
+        }
+      }
+      if (std::chrono::steady_clock::now() >= next) {
+        Refresh(false);
+        next = std::chrono::steady_clock::now() + kRefreshInterval;
+      }
+    }
+    if (fd >= 0) close(fd);
+  }
+
+  // Milliseconds without device node events before refreshing.
+  static constexpr int32_t kSettleTime = 500;
+#else
+  void Run() {
+    auto next = std::chrono::steady_clock::now() + kRefreshInterval;
+    while (!IsStopped()) {
+      Wait(next);
+      if (std::chrono::steady_clock::now() >= next) {
+        Refresh(false);
+        next = std::chrono::steady_clock::now() + kRefreshInterval;
+      }
+    }
+  }
+#endif
+
+  bool IsStopped() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return is_stopped_;
+  }
+
+  void Wait(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait_until(lock, deadline, [this]() { return is_stopped_; });
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  // Guards the libVLC objects, created on first use as loading the plugins
+  // is slow.
+  std::mutex vlc_mutex_;
+  std::unique_ptr<VLC::Instance> vlc_instance_;
+  std::unique_ptr<VLC::MediaPlayer> vlc_media_player_;
+  std::vector<Device> devices_;
+  bool is_enumerated_ = false;
+  bool is_stopped_ = false;
+  ChangeCallback change_callback_ = [](const std::vector<Device>&) -> void {};
+  std::thread watch_thread_;
 };
 
+extern std::unique_ptr<Devices> g_devices;
+
 #endif
@@ -78,6 +78,7 @@ class Equalizer {
     pre_amp_ = vlc_equalizer_.preamp();
   }
 
+  friend class PlayerEvents;
   friend class PlayerSetters;
 };
 
@@ -0,0 +1,217 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_AUDIOANALYZER_H_
+#define INTERNAL_AUDIOANALYZER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "internal/audiotap.h"
+#include "internal/fft.h"
+#include "internal/ringbuffer.h"
+
+// Computes a spectrum of log-spaced bands & per channel RMS & peak levels
+// from the samples of an |AudioTap|. The audio thread only copies samples
+// into a ring, the analysis runs on the analyzer's own thread.
+class AudioAnalyzer {
+ public:
+  struct Analysis {
+    // Power of each band in dBFS, from low to high frequencies.
+    std::vector<float> bands;
+    // Linear levels of each channel since the previous analysis.
+    std::vector<float> rms;
+    std::vector<float> peak;
+  };
+
+  // Called on the analyzer's thread.
+  typedef std::function<void(const Analysis&)> Callback;
+
+  explicit AudioAnalyzer(AudioTap* tap)
+      : tap_(tap), ring_(kRingFrames * tap->channels()) {
+    tap_->AddListener(
+        [this](const float* samples, int32_t frames, int32_t channels) {
+          if (!is_running_.load(std::memory_order_acquire)) return;
+          // Whole frames only, so that channels stay aligned.
+          size_t count = std::min<size_t>(frames, ring_.Space() / channels);
+          ring_.Write(samples, count * channels);
+        });
+  }
+
+  ~AudioAnalyzer() { Stop(); }
+
+  // Analyzes the last |fft_size| frames into |bands| bands |frequency| times
+  // per second while audio is playing. |fft_size| is rounded to a power of
+  // two. A running analysis is stopped first.
+  void Start(int32_t bands, int32_t fft_size, int32_t frequency,
+             Callback callback) {
+    Stop();
+    int32_t size = kMinimumFftSize;
+    while (size < std::min(fft_size, kMaximumFftSize)) size <<= 1;
+    bands = std::max(1, bands);
+    auto interval = std::chrono::microseconds(
+        1000000 / std::clamp(frequency, 1, kMaximumFrequency));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = false;
+    }
+    ring_.Clear();
+    is_running_.store(true, std::memory_order_release);
+    thread_ = std::thread([=]() -> void {
+      Run(bands, size, interval, callback);
+    });
+  }
+
+  void Stop() {
+    is_running_.store(false, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = true;
+    }
+    condition_.notify_all();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  // Returns the latest analysis, empty until audio was analyzed.
+  Analysis Snapshot() {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    return snapshot_;
+  }
+
+ private:
+  // Frames buffered between two analyses, enough for 8 Hz at 192 kHz.
+  static constexpr size_t kRingFrames = 1 << 15;
+  static constexpr int32_t kMinimumFftSize = 256;
+  static constexpr int32_t kMaximumFftSize = 16384;
+  static constexpr int32_t kMaximumFrequency = 120;
+  static constexpr float kMinimumBandFrequency = 20.0f;
+  static constexpr float kSilence = -120.0f;
+
+  void Run(int32_t band_count, int32_t size,
+           std::chrono::microseconds interval, Callback callback) {
+    int32_t channels = tap_->channels();
+    Fft fft(size);
+    // Hann window, the last |size| frames mixed down to mono are kept in
+    // |history| as a circular buffer starting at |history_index|.
+    std::vector<float> window(size), history(size, 0.0f);
+    float window_sum = 0.0f;
+    for (int32_t index = 0; index < size; index++) {
+      window[index] = 0.5f - 0.5f * std::cos(2.0f * 3.14159265f * index /
+                                              (size - 1));
+      window_sum += window[index];
+    }
+    size_t history_index = 0;
+    std::vector<float> samples(kRingFrames * channels);
+    std::vector<float> real(size), imaginary(size), power(size / 2 + 1);
+    Analysis analysis;
+    analysis.bands.resize(band_count);
+    analysis.rms.resize(channels);
+    analysis.peak.resize(channels);
+    auto next = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!condition_.wait_until(lock, next += interval,
+                                  [this]() { return is_stopped_; })) {
+      size_t frames = ring_.Read(samples.data(), samples.size()) / channels;
+      if (frames == 0) continue;
+      std::fill(analysis.rms.begin(), analysis.rms.end(), 0.0f);
+      std::fill(analysis.peak.begin(), analysis.peak.end(), 0.0f);
+      for (size_t frame = 0; frame < frames; frame++) {
+        float mono = 0.0f;
+        for (int32_t channel = 0; channel < channels; channel++) {
+          float sample = samples[frame * channels + channel];
+          analysis.rms[channel] += sample * sample;
+          analysis.peak[channel] =
+              std::max(analysis.peak[channel], std::abs(sample));
+          mono += sample;
+        }
+        history[history_index] = mono / channels;
+        history_index = (history_index + 1) % size;
+      }
+      for (float& rms : analysis.rms) rms = std::sqrt(rms / frames);
+      for (int32_t index = 0; index < size; index++) {
+        real[index] = history[(history_index + index) % size] * window[index];
+        imaginary[index] = 0.0f;
+      }
+      fft.Transform(real.data(), imaginary.data());
+      // Single-sided power, a full scale sine reads 0 dBFS.
+      float scale = 2.0f / window_sum;
+      for (int32_t bin = 0; bin <= size / 2; bin++) {
+        float magnitude_real = real[bin] * scale;
+        float magnitude_imaginary = imaginary[bin] * scale;
+        power[bin] = magnitude_real * magnitude_real +
+                     magnitude_imaginary * magnitude_imaginary;
+      }
+      ComputeBands(power, size, static_cast<float>(tap_->rate()),
+                   analysis.bands);
+      {
+        std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+        snapshot_ = analysis;
+      }
+      lock.unlock();
+      callback(analysis);
+      lock.lock();
+    }
+  }
+
+  // Averages the power of the bins of each band, bands are log-spaced from
+  // |kMinimumBandFrequency| up to the Nyquist frequency. Bands narrower than
+  // a bin take the bin containing their center.
+  static void ComputeBands(const std::vector<float>& power, int32_t size,
+                           float rate, std::vector<float>& bands) {
+    if (rate <= 0.0f) rate = 48000.0f;
+    float resolution = rate / size;
+    float nyquist = rate / 2.0f;
+    float ratio = std::log(nyquist / kMinimumBandFrequency);
+    int32_t count = static_cast<int32_t>(bands.size());
+    int32_t last_bin = size / 2;
+    for (int32_t band = 0; band < count; band++) {
+      float low = kMinimumBandFrequency *
+                  std::exp(ratio * band / static_cast<float>(count));
+      float high = kMinimumBandFrequency *
+                   std::exp(ratio * (band + 1) / static_cast<float>(count));
+      int32_t first = std::min(
+          last_bin, static_cast<int32_t>(std::ceil(low / resolution)));
+      int32_t end = std::min(
+          last_bin + 1, static_cast<int32_t>(std::ceil(high / resolution)));
+      float sum = 0.0f;
+      if (end > first) {
+        for (int32_t bin = first; bin < end; bin++) sum += power[bin];
+        sum /= end - first;
+      } else {
+        int32_t center = static_cast<int32_t>(
+            std::sqrt(low * high) / resolution + 0.5f);
+        sum = power[std::min(center, last_bin)];
+      }
+      bands[band] = sum > 0.0f ? std::max(kSilence, 10.0f * std::log10(sum))
+                               : kSilence;
+    }
+  }
+
+  AudioTap* tap_;
+  // Written by the audio thread, read by the analyzer's.
+  RingBuffer<float> ring_;
+  std::atomic<bool> is_running_ = false;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool is_stopped_ = true;
+  std::mutex snapshot_mutex_;
+  Analysis snapshot_;
+};
+
+#endif
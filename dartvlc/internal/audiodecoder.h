@@ -0,0 +1,182 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_AUDIODECODER_H_
+#define INTERNAL_AUDIODECODER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <vlcpp/vlc.hpp>
+
+class AudioDecoder;
+
+// Decoders of an owner, stopped at once when it is destroyed instead of
+// waiting for each to decode its whole media.
+class AudioDecoderGroup {
+ public:
+  // Stops the running decoders & those created afterwards.
+  inline void Stop();
+
+ private:
+  friend class AudioDecoder;
+
+  std::mutex mutex_;
+  std::set<AudioDecoder*> decoders_;
+  bool is_stopped_ = false;
+};
+
+// Decodes the audio of a media as fast as possible without any output, as
+// interleaved 32-bit float stereo at |kRate| Hz. Samples are received from
+// libVLC's smem stream output, which hands them over as soon as they are
+// transcoded instead of at playback pace. Used for loudness & waveform
+// analysis.
+class AudioDecoder {
+ public:
+  static constexpr int32_t kRate = 48000;
+  static constexpr int32_t kChannels = 2;
+
+  // Called on the stream output thread with |frames| interleaved frames.
+  typedef std::function<void(const float* samples, size_t frames)> Callback;
+
+  // Stopped along with |group| if not nullptr.
+  AudioDecoder(const std::string& location, Callback callback,
+               AudioDecoderGroup* group = nullptr)
+      : callback_(callback), group_(group) {
+    VLC::Media media =
+        VLC::Media(Instance(), location, VLC::Media::FromLocation);
+    media.addOption(
+        ":sout=#transcode{acodec=fl32,channels=" + std::to_string(kChannels) +
+        ",samplerate=" + std::to_string(kRate) +
+        "}:smem{audio-prerender-callback=" +
+        Address(reinterpret_cast<void*>(&OnPrerender)) +
+        ",audio-postrender-callback=" +
+        Address(reinterpret_cast<void*>(&OnPostrender)) +
+        ",audio-data=" + Address(this) + ",time-sync=false}");
+    media.addOption(":no-sout-video");
+    media.addOption(":no-sout-spu");
+    vlc_media_player_ = VLC::MediaPlayer(media);
+    vlc_media_player_.eventManager().onEndReached([=]() -> void {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_ended_ = true;
+      condition_.notify_all();
+    });
+    vlc_media_player_.eventManager().onEncounteredError([=]() -> void {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_ended_ = is_failed_ = true;
+      condition_.notify_all();
+    });
+    if (group_) {
+      std::lock_guard<std::mutex> lock(group_->mutex_);
+      group_->decoders_.insert(this);
+      if (group_->is_stopped_) Stop();
+    }
+  }
+
+  ~AudioDecoder() {
+    if (group_) {
+      std::lock_guard<std::mutex> lock(group_->mutex_);
+      group_->decoders_.erase(this);
+    }
+    vlc_media_player_.stop();
+  }
+
+  // Decodes the whole media. Returns false if it could not be decoded, was
+  // stopped, or no samples were received for |timeout| milliseconds.
+  bool Decode(int64_t timeout = 10000) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (is_stopped_) return false;
+    }
+    vlc_media_player_.play();
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t serial = serial_;
+    while (!is_ended_) {
+      condition_.wait_for(lock, std::chrono::milliseconds(timeout));
+      if (!is_ended_ && serial_ == serial) return false;
+      serial = serial_;
+    }
+    return !is_failed_ && frames_ > 0;
+  }
+
+  // Interrupts |Decode|, which returns false. May be called from any thread.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = is_ended_ = is_failed_ = true;
+      condition_.notify_all();
+    }
+    // Outside of |mutex_|, which the stream output thread takes until it
+    // is stopped.
+    vlc_media_player_.stop();
+  }
+
+ private:
+  // smem takes its callbacks as addresses in decimal.
+  static std::string Address(void* pointer) {
+    return std::to_string(reinterpret_cast<intptr_t>(pointer));
+  }
+
+  static void OnPrerender(void* data, uint8_t** buffer, size_t size) {
+    auto decoder = static_cast<AudioDecoder*>(data);
+    decoder->buffer_.resize(size);
+    *buffer = decoder->buffer_.data();
+  }
+
+  static void OnPostrender(void* data, uint8_t* buffer, uint32_t channels,
+                           uint32_t rate, uint32_t frames, uint32_t bits,
+                           size_t size, int64_t pts) {
+    auto decoder = static_cast<AudioDecoder*>(data);
+    // Guaranteed by the transcode chain, anything else is a broken stream.
+    if (channels == kChannels && bits == 32) {
+      decoder->callback_(reinterpret_cast<const float*>(buffer), frames);
+    }
+    std::lock_guard<std::mutex> lock(decoder->mutex_);
+    decoder->frames_ += frames;
+    decoder->serial_++;
+    decoder->condition_.notify_all();
+  }
+
+  // Shared by all decoders, so that plugins are only loaded once.
+  static VLC::Instance& Instance() {
+    static const char* kArguments[] = {"--no-video", "--no-osd", "--no-spu",
+                                       "--no-sout-video"};
+    static VLC::Instance instance = VLC::Instance(
+        sizeof(kArguments) / sizeof(kArguments[0]), kArguments);
+    return instance;
+  }
+
+  Callback callback_;
+  AudioDecoderGroup* group_;
+  VLC::MediaPlayer vlc_media_player_;
+  // Written by smem only.
+  std::vector<uint8_t> buffer_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  uint64_t frames_ = 0;
+  uint64_t serial_ = 0;
+  bool is_ended_ = false;
+  bool is_failed_ = false;
+  bool is_stopped_ = false;
+};
+
+void AudioDecoderGroup::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  is_stopped_ = true;
+  for (AudioDecoder* decoder : decoders_) decoder->Stop();
+}
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_AUDIOPASSTHROUGH_H_
+#define INTERNAL_AUDIOPASSTHROUGH_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vlcpp/vlc.hpp>
+
+#include "internal/ringbuffer.h"
+
+// Plays the samples received by an |AudioTap| on the audio output, which the
+// tap replaces. They are fed as raw PCM to a second player of the same
+// instance through libVLC's media callbacks, so that the tapped audio is
+// still heard.
+class AudioPassthrough {
+ public:
+  // Frames buffered between the tap & the output.
+  static constexpr size_t kCapacity = 1 << 15;
+  // Milliseconds of input caching of the output player, kept minimal as the
+  // samples were already buffered by the tapped player.
+  static constexpr int64_t kCaching = 20;
+  // Microseconds between a sample being tapped & heard: the input caching
+  // of the output player plus a typical audio output buffer. Tapped players
+  // compensate it with their audio delay.
+  static constexpr int64_t kLatency = (kCaching + 40) * 1000;
+
+  AudioPassthrough(VLC::Instance& instance, int32_t channels)
+      : vlc_instance_(instance),
+        vlc_media_player_(instance),
+        channels_(channels),
+        ring_(kCapacity * channels) {}
+
+  ~AudioPassthrough() { Stop(); }
+
+  // Listener of the tap, called on its audio thread. Frames which do not fit
+  // are dropped whole.
+  void Write(const float* samples, int32_t frames) {
+    size_t space = ring_.Space() / channels_;
+    ring_.Write(samples, std::min<size_t>(space, frames) * channels_);
+    condition_.notify_one();
+  }
+
+  // Starts the output at |rate| Hz, restarting it if it was playing another
+  // rate. Must not be called from a libVLC thread.
+  void Start(int32_t rate) {
+    if (rate <= 0 || rate == rate_) return;
+    Stop();
+    ring_.Clear();
+    rate_ = rate;
+    is_stopped_ = false;
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    libvlc_media_t* media = libvlc_media_new_callbacks(
+        &AudioPassthrough::OnOpen, &AudioPassthrough::OnRead, nullptr,
+        nullptr, this);
+#else
+    libvlc_media_t* media = libvlc_media_new_callbacks(
+        vlc_instance_.get(), &AudioPassthrough::OnOpen,
+        &AudioPassthrough::OnRead, nullptr, nullptr, this);
+#endif
+    if (!media) return;
+    VLC::Media vlc_media(media, false);
+    vlc_media.addOption(":demux=rawaud");
+    vlc_media.addOption(":rawaud-fourcc=f32l");
+    vlc_media.addOption(":rawaud-channels=" + std::to_string(channels_));
+    vlc_media.addOption(":rawaud-samplerate=" + std::to_string(rate));
+    for (const char* option : {":file-caching=", ":live-caching=",
+                               ":network-caching="}) {
+      vlc_media.addOption(option + std::to_string(kCaching));
+    }
+    vlc_media_player_.setMedia(vlc_media);
+    vlc_media_player_.play();
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = true;
+    }
+    condition_.notify_all();
+    vlc_media_player_.stop();
+    rate_ = 0;
+  }
+
+  void SetDevice(const std::string& id) {
+    vlc_media_player_.outputDeviceSet(id);
+  }
+
+ private:
+  // Silence played when the tap delivers nothing for this long, e.g. while
+  // its player is paused or seeking, so that the output clock keeps running
+  // instead of dropping the samples which follow as late.
+  static constexpr auto kSilenceDelay = std::chrono::milliseconds(100);
+
+  static int OnOpen(void* opaque, void** data, uint64_t* size) {
+    *data = opaque;
+    *size = UINT64_MAX;
+    return 0;
+  }
+
+  static ssize_t OnRead(void* data, unsigned char* buffer, size_t size) {
+    return static_cast<AudioPassthrough*>(data)->Read(buffer, size);
+  }
+
+  // Called on the input thread of |vlc_media_player_|, returns 0 once
+  // stopped, which ends the stream.
+  ssize_t Read(unsigned char* buffer, size_t size) {
+    size_t frame_size = sizeof(float) * channels_;
+    size_t frames = size / frame_size;
+    if (frames == 0) return 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait_for(lock, kSilenceDelay, [&]() -> bool {
+        return is_stopped_ || ring_.Available() > 0;
+      });
+      if (is_stopped_) return 0;
+    }
+    size_t available = ring_.Available() / channels_;
+    if (available > 0) {
+      size_t count = std::min(frames, available) * channels_;
+      return static_cast<ssize_t>(
+          ring_.Read(reinterpret_cast<float*>(buffer), count) *
+          sizeof(float));
+    }
+    size_t silence = std::min<size_t>(
+        frames, static_cast<size_t>(rate_) * kSilenceDelay.count() / 1000);
+    std::memset(buffer, 0, silence * frame_size);
+    return static_cast<ssize_t>(silence * frame_size);
+  }
+
+  VLC::Instance vlc_instance_;
+  VLC::MediaPlayer vlc_media_player_;
+  int32_t channels_;
+  std::atomic<int32_t> rate_ = 0;
+  RingBuffer<float> ring_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool is_stopped_ = true;
+};
+
+#endif
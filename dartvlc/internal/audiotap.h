@@ -0,0 +1,229 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_AUDIOTAP_H_
+#define INTERNAL_AUDIOTAP_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vlcpp/vlc.hpp>
+
+#include "internal/ringbuffer.h"
+
+// Receives the decoded audio of a player as 32-bit float PCM through libVLC's
+// audio callbacks, which replace its audio output, & stores it in lock-free
+// rings: a single interleaved one or one per channel. See |AudioPassthrough|
+// to keep the audio playing.
+class AudioTap {
+ public:
+  static constexpr int32_t kMaxChannels = 8;
+
+  enum Layout : int32_t { interleaved, planar };
+
+  // Called on the audio thread with interleaved samples, must not block.
+  typedef std::function<void(const float* samples, int32_t frames,
+                             int32_t channels)>
+      Listener;
+
+  // Receives every sample of a single attached player, whether it is active
+  // or not, see |SetOutput|. Both are called on its audio thread.
+  struct Output {
+    std::function<void(int32_t rate)> on_format;
+    Listener write;
+  };
+
+  // Converts to |rate| Hz, 0 for the rate of the media, & to |channels|.
+  // Each ring holds |capacity| frames.
+  AudioTap(int32_t rate, int32_t channels, Layout layout, int32_t capacity)
+      : requested_rate_(std::max(0, rate)),
+        channels_(std::clamp(channels, 1, kMaxChannels)),
+        layout_(layout),
+        listeners_(std::make_shared<std::vector<Listener>>()) {
+    size_t frames = static_cast<size_t>(std::max(1, capacity));
+    if (layout_ == planar) {
+      for (int32_t channel = 0; channel < channels_; channel++) {
+        rings_.emplace_back(std::make_unique<RingBuffer<float>>(frames));
+      }
+    } else {
+      rings_.emplace_back(
+          std::make_unique<RingBuffer<float>>(frames * channels_));
+    }
+    scratch_.resize(kScratchFrames * channels_);
+  }
+
+  // Rate of the samples, 0 until the first media is opened.
+  int32_t rate() const { return rate_; }
+
+  int32_t channels() const { return channels_; }
+
+  Layout layout() const { return layout_; }
+
+  // One ring per channel for |planar|, a single one otherwise.
+  std::vector<std::unique_ptr<RingBuffer<float>>>& rings() { return rings_; }
+
+  // Called on the audio thread with the rate & channels once negotiated with
+  // each opened media.
+  void OnFormat(std::function<void(int32_t, int32_t)> callback) {
+    format_callback_ = callback;
+  }
+
+  // Adds a reader of the samples, alongside the rings.
+  void AddListener(Listener listener) {
+    std::lock_guard<std::mutex> lock(listeners_mutex_);
+    auto listeners =
+        std::make_shared<std::vector<Listener>>(*std::atomic_load(&listeners_));
+    listeners->emplace_back(listener);
+    std::atomic_store(&listeners_, listeners);
+  }
+
+  // Installs the callbacks on |player|, effective from the next media it
+  // opens. Only the samples of players for which |is_active| returns true
+  // are kept. The format a player negotiates while inactive is published by
+  // |Activate|.
+  void Attach(VLC::MediaPlayer& player, std::function<bool()> is_active) {
+    libvlc_media_player_t* raw_player = player.get();
+    auto slot = std::make_shared<OutputSlot>();
+    {
+      std::lock_guard<std::mutex> lock(rates_mutex_);
+      slots_[raw_player] = slot;
+    }
+    player.setAudioFormatCallbacks(
+        [=](char* format, uint32_t* rate, uint32_t* channels) -> int32_t {
+          std::memcpy(format, "FL32", 4);
+          if (requested_rate_ > 0) *rate = requested_rate_;
+          *channels = channels_;
+          {
+            std::lock_guard<std::mutex> lock(rates_mutex_);
+            rates_[raw_player] = static_cast<int32_t>(*rate);
+          }
+          std::shared_ptr<Output> output = std::atomic_load(&slot->output);
+          if (output) output->on_format(static_cast<int32_t>(*rate));
+          if (is_active()) Publish(static_cast<int32_t>(*rate));
+          return 0;
+        },
+        nullptr);
+    player.setAudioCallbacks(
+        [=](const void* samples, uint32_t count, int64_t) -> void {
+          std::shared_ptr<Output> output = std::atomic_load(&slot->output);
+          if (output) {
+            output->write(static_cast<const float*>(samples),
+                          static_cast<int32_t>(count), channels_);
+          }
+          if (!is_active()) return;
+          Write(static_cast<const float*>(samples), count);
+        },
+        nullptr, nullptr, nullptr, nullptr);
+  }
+
+  // Sets the |output| of the attached |player|. |Output::on_format| is called
+  // right away if the player already negotiated a format.
+  void SetOutput(libvlc_media_player_t* player, Output output) {
+    int32_t rate = 0;
+    std::shared_ptr<OutputSlot> slot;
+    {
+      std::lock_guard<std::mutex> lock(rates_mutex_);
+      auto it = slots_.find(player);
+      if (it == slots_.end()) return;
+      slot = it->second;
+      auto rate_it = rates_.find(player);
+      if (rate_it != rates_.end()) rate = rate_it->second;
+    }
+    auto value = std::make_shared<Output>(std::move(output));
+    std::atomic_store(&slot->output, value);
+    if (rate > 0) value->on_format(rate);
+  }
+
+  // Publishes the format negotiated by |player|, which just became active,
+  // e.g. after a gapless transition.
+  void Activate(libvlc_media_player_t* player) {
+    int32_t rate = 0;
+    {
+      std::lock_guard<std::mutex> lock(rates_mutex_);
+      auto it = rates_.find(player);
+      if (it == rates_.end()) return;
+      rate = it->second;
+    }
+    Publish(rate);
+  }
+
+ private:
+  // Frames deinterleaved at a time for |planar|.
+  static constexpr size_t kScratchFrames = 4096;
+
+  // Replaced as a whole, so that the audio thread never waits on a lock.
+  struct OutputSlot {
+    std::shared_ptr<Output> output;
+  };
+
+  void Publish(int32_t rate) {
+    rate_ = rate;
+    format_callback_(rate, channels_);
+  }
+
+  void Write(const float* samples, size_t frames) {
+    // Both players may briefly be active while they exchange roles, the rings
+    // only have a single producer.
+    if (is_writing_.exchange(true, std::memory_order_acquire)) return;
+    // Frames which do not fit are dropped whole, so that channels stay
+    // aligned.
+    size_t space = frames;
+    if (layout_ == interleaved) {
+      space = std::min(space, rings_.front()->Space() / channels_);
+      rings_.front()->Write(samples, space * channels_);
+    } else {
+      for (auto& ring : rings_) space = std::min(space, ring->Space());
+      for (size_t first = 0; first < space; first += kScratchFrames) {
+        size_t count = std::min(kScratchFrames, space - first);
+        const float* block = samples + first * channels_;
+        for (int32_t channel = 0; channel < channels_; channel++) {
+          float* plane = scratch_.data() + channel * kScratchFrames;
+          for (size_t frame = 0; frame < count; frame++) {
+            plane[frame] = block[frame * channels_ + channel];
+          }
+          rings_[channel]->Write(plane, count);
+        }
+      }
+    }
+    std::shared_ptr<std::vector<Listener>> listeners =
+        std::atomic_load(&listeners_);
+    for (Listener& listener : *listeners) {
+      listener(samples, static_cast<int32_t>(frames), channels_);
+    }
+    is_writing_.store(false, std::memory_order_release);
+  }
+
+  int32_t requested_rate_;
+  int32_t channels_;
+  Layout layout_;
+  std::atomic<int32_t> rate_ = 0;
+  // Last rate negotiated by each attached player.
+  std::map<libvlc_media_player_t*, int32_t> rates_;
+  std::map<libvlc_media_player_t*, std::shared_ptr<OutputSlot>> slots_;
+  // Guards |rates_| & |slots_|.
+  std::mutex rates_mutex_;
+  std::atomic<bool> is_writing_ = false;
+  std::vector<std::unique_ptr<RingBuffer<float>>> rings_;
+  // Used by the audio thread only.
+  std::vector<float> scratch_;
+  // Replaced as a whole, so that the audio thread never waits on a lock.
+  std::shared_ptr<std::vector<Listener>> listeners_;
+  std::mutex listeners_mutex_;
+  std::function<void(int32_t, int32_t)> format_callback_ =
+      [](int32_t, int32_t) -> void {};
+};
+
+#endif
@@ -9,58 +9,47 @@
  * GNU Lesser General Public License v2.1
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
 #include "internal/getters.h"
 
 typedef std::function<void(uint8_t*, int32_t, int32_t)> VideoFrameCallback;
 
+// Called with the requested & the reached time, the latency of the seek (all
+// in microseconds) & the number of requests dropped in favour of it.
+typedef std::function<void(int64_t, int64_t, int64_t, int32_t)> SeekCallback;
+
 class PlayerEvents : public PlayerGetters {
  public:
+  // Called with the playlist locked, |state()| may be read from |callback|.
   void OnOpen(std::function<void(VLC::Media)> callback) {
     open_callback_ = callback;
-    vlc_media_player_.eventManager().onMediaChanged(
-        std::bind(&PlayerEvents::OnOpenCallback, this, std::placeholders::_1));
   }
 
-  void OnPlay(std::function<void()> callback) {
-    play_callback_ = callback;
-    vlc_media_player_.eventManager().onPlaying(
-        std::bind(&PlayerEvents::OnPlayCallback, this));
-  }
+  void OnPlay(std::function<void()> callback) { play_callback_ = callback; }
 
   void OnVideoDimensions(std::function<void(int32_t, int32_t)> callback) {
     video_dimension_callback_ = callback;
-    vlc_media_player_.eventManager().onPlaying(
-        std::bind(&PlayerEvents::OnVideoDimensionsCallback, this));
   }
 
-  void OnPause(std::function<void()> callback) {
-    pause_callback_ = callback;
-    vlc_media_player_.eventManager().onPaused(
-        std::bind(&PlayerEvents::OnPauseCallback, this));
-  }
+  void OnPause(std::function<void()> callback) { pause_callback_ = callback; }
 
-  void OnStop(std::function<void()> callback) {
-    stop_callback_ = callback;
-    vlc_media_player_.eventManager().onStopped(
-        std::bind(&PlayerEvents::OnStopCallback, this));
-  }
+  void OnStop(std::function<void()> callback) { stop_callback_ = callback; }
 
   void OnPosition(std::function<void(int32_t)> callback) {
     position_callback_ = callback;
-    vlc_media_player_.eventManager().onPositionChanged(std::bind(
-        &PlayerEvents::OnPositionCallback, this, std::placeholders::_1));
   }
 
   void OnSeekable(std::function<void(bool)> callback) {
     seekable_callback_ = callback;
-    vlc_media_player_.eventManager().onSeekableChanged(std::bind(
-        &PlayerEvents::OnSeekableCallback, this, std::placeholders::_1));
   }
 
   void OnComplete(std::function<void()> callback) {
     complete_callback_ = callback;
-    vlc_media_player_.eventManager().onEndReached(
-        std::bind(&PlayerEvents::OnCompleteCallback, this));
   }
 
   void OnVolume(std::function<void(float)> callback) {
@@ -71,35 +60,416 @@ class PlayerEvents : public PlayerGetters {
     rate_callback_ = callback;
   }
 
+  // Called with the playlist locked once it was modified, the modified
+  // entries are reported by |PlayerState::changed_start()| & |changed_end()|.
   void OnPlaylist(std::function<void()> callback) {
     playlist_callback_ = callback;
   }
 
   void OnVideo(VideoFrameCallback callback) { video_callback_ = callback; }
 
+  // Called once a seek started by |PlayerSetters::SeekTime| completed, see
+  // |SeekCallback|.
+  void OnSeek(SeekCallback callback) {
+    seek_callback_ = callback;
+  }
+
+  // Called with the entry which started & the time in microseconds between
+  // the end of the previous entry & the first position update of this one,
+  // whenever an entry follows another automatically.
+  void OnGapless(std::function<void(int32_t, int64_t)> callback) {
+    gapless_callback_ = callback;
+  }
+
+  // Called on the audio thread with the rate & channels of the samples
+  // tapped by |PlayerSetters::EnableAudioTap| whenever a media is opened.
+  void OnAudioFormat(std::function<void(int32_t, int32_t)> callback) {
+    audio_format_callback_ = callback;
+  }
+
+  // Called on the analyzer's thread with each analysis started by
+  // |PlayerSetters::SetAnalysis|.
+  void OnAnalysis(
+      std::function<void(const AudioAnalyzer::Analysis&)> callback) {
+    analysis_callback_ = callback;
+  }
+
+  // Called with the iteration whenever the loop region set by
+  // |PlayerSetters::SetLoopRegion| wraps around.
+  void OnLoop(std::function<void(int32_t)> callback) {
+    loop_callback_ = callback;
+  }
+
+  // Called with the path of the file when a recording started by
+  // |PlayerSetters::StartRecording| starts or stops.
+  void OnRecording(std::function<void(bool, const std::string&)> callback) {
+    recording_callback_ = callback;
+  }
+
  protected:
+  // Registers the event handlers of |player|. Both |vlc_players_| report
+  // events, only those of the active one are handled.
+  void AttachEvents(VLC::MediaPlayer& player) {
+    libvlc_media_player_t* raw_player = player.get();
+    auto is_active = [=]() -> bool { return IsActive(raw_player); };
+    auto& event_manager = player.eventManager();
+    event_manager.onMediaChanged([=](VLC::MediaPtr vlc_media_ptr) -> void {
+      if (is_active()) OnOpenCallback(vlc_media_ptr);
+    });
+    event_manager.onPlaying([=]() -> void {
+      if (!is_active()) return;
+      OnPlayCallback();
+      OnVideoDimensionsCallback();
+    });
+    event_manager.onPaused([=]() -> void {
+      if (is_active()) OnPauseCallback();
+    });
+    event_manager.onStopped([=]() -> void {
+      if (is_active()) OnStopCallback();
+    });
+    event_manager.onPositionChanged([=](float relative_position) -> void {
+      if (is_active()) OnPositionCallback(relative_position);
+    });
+    event_manager.onTimeChanged([=](libvlc_time_t time) -> void {
+      if (is_active()) OnTimeCallback(time);
+    });
+    event_manager.onSeekableChanged([=](bool is_seekable) -> void {
+      if (is_active()) OnSeekableCallback(is_seekable);
+    });
+    event_manager.onEndReached([=]() -> void {
+      if (is_active()) OnEndReachedCallback();
+    });
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    libvlc_event_attach(libvlc_media_player_event_manager(raw_player),
+                        libvlc_MediaPlayerRecordChanged,
+                        &PlayerEvents::OnRecordChanged, this);
+#endif
+  }
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+  static void OnRecordChanged(const libvlc_event_t* event, void* data) {
+    PlayerEvents* self = static_cast<PlayerEvents*>(data);
+    if (!self->IsActive(static_cast<libvlc_media_player_t*>(event->p_obj))) {
+      return;
+    }
+    const auto& change = event->u.media_player_record_changed;
+    std::string path =
+        change.recorded_file_path ? change.recorded_file_path : "";
+    self->recording_callback_(change.recording, path);
+  }
+#endif
+
+  // Reports the end of the recording of the current entry, its sout does
+  // not apply to the entries opened after it. libVLC 4 reports it itself.
+  void ResetRecording() {
+#if LIBVLC_VERSION_INT < LIBVLC_VERSION(4, 0, 0, 0)
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    if (recording_path_.empty()) return;
+    recording_callback_(false, recording_path_);
+    recording_path_.clear();
+#endif
+  }
+
+  // Returns the media of entry |index|. Medias are created for the entries
+  // around it & released once they move out of the window.
+  VLC::Media& MediaAt(int32_t index) {
+    for (auto it = vlc_medias_.begin(); it != vlc_medias_.end();) {
+      if (std::abs(it->first - index) > kMediaWindow) {
+        it = vlc_medias_.erase(it);
+      } else {
+        it++;
+      }
+    }
+    int32_t last = static_cast<int32_t>(state()->medias()->size()) - 1;
+    for (int32_t i = std::max(0, index - kMediaWindow);
+         i <= std::min(last, index + kMediaWindow); i++) {
+      if (vlc_medias_.find(i) == vlc_medias_.end()) {
+        std::string location = state()->medias()->media(i)->location();
+        vlc_medias_.emplace(i, VLC::Media(vlc_instance_, location,
+                                          VLC::Media::FromLocation));
+      }
+    }
+    return vlc_medias_.at(index);
+  }
+
+  // Plays entry |index|. The current entry is added to the shuffle history
+  // if |is_recorded| is true.
+  void PlayIndex(int32_t index, bool is_recorded = true) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    if (index < 0 || index >= state()->medias()->size()) return;
+    CancelCrossfade();
+    loop_watcher_.Stop();
+    ResetRecording();
+    seek_scheduler_.Reset();
+    seek_target_ = -1;
+    if (is_shuffle_ && is_recorded && state()->is_started_) {
+      shuffle_.Push(state()->index_);
+    }
+    state()->index_ = index;
+    state()->is_started_ = true;
+    is_prefetch_requested_ = false;
+    std::atomic_store(&keyframe_index_, {});
+    // Until it is paused the prefetched entry is still opening, resuming it
+    // would have no effect.
+    if (index == standby_index_ &&
+        vlc_standby_player().state() == libvlc_Paused) {
+      SwitchToStandby();
+      return;
+    }
+    DiscardPrefetch();
+    ApplyNormalization(vlc_media_player(), index);
+    vlc_media_player().setMedia(MediaAt(index));
+    vlc_media_player().play();
+  }
+
+  // Reopens the current entry at the current time with |options|, e.g. to
+  // attach a sout to it or detach it.
+  void Reopen(const std::vector<std::string>& options) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    int32_t index = state()->index_;
+    if (index < 0 || index >= state()->medias()->size()) return;
+    int64_t time = std::max<int64_t>(vlc_media_player().time(), 0);
+    bool is_paused = vlc_media_player().state() == libvlc_Paused;
+    // Not shared with |vlc_medias_|, options must not leak into regular
+    // playback.
+    VLC::Media vlc_media(vlc_instance_,
+                         state()->medias()->media(index)->location(),
+                         VLC::Media::FromLocation);
+    for (const std::string& option : options) vlc_media.addOption(option);
+    // Formatted by hand, the decimal separator must not follow the locale.
+    std::string milliseconds = std::to_string(time % 1000);
+    vlc_media.addOption(":start-time=" + std::to_string(time / 1000) + "." +
+                        std::string(3 - milliseconds.size(), '0') +
+                        milliseconds);
+    if (is_paused) vlc_media.addOption(":start-paused");
+    ApplyNormalization(vlc_media_player(), index);
+    vlc_media_player().setMedia(vlc_media);
+    vlc_media_player().play();
+  }
+
+  // Applies |equalizer_| & the gain normalizing entry |index| to |player|.
+  // Entries are measured in the background, starting with the current one &
+  // the next, so the gain is only applied once known, i.e. from the next
+  // time an entry is opened.
+  void ApplyNormalization(VLC::MediaPlayer& player, int32_t index) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    std::optional<double> gain = NormalizationGain(index);
+    if (!gain && !equalizer_) {
+      player.unsetEqualizer();
+      return;
+    }
+    // |Equalizer| copies share the underlying libVLC equalizer.
+    Equalizer equalizer;
+    if (equalizer_) {
+      for (const auto& [band, amp] : equalizer_->band_amps()) {
+        equalizer.SetBandAmp(band, amp);
+      }
+      equalizer.SetPreAmp(equalizer_->pre_amp());
+    }
+    if (gain) {
+      equalizer.SetPreAmp(std::clamp(
+          equalizer.pre_amp() + static_cast<float>(*gain), -20.0f, 20.0f));
+    }
+    player.setEqualizer(equalizer.vlc_equalizer_);
+  }
+
+  // Returns the gain in dB bringing entry |index| to |loudness_target_|,
+  // without letting its true peak exceed |kTruePeakCeiling|.
+  std::optional<double> NormalizationGain(int32_t index) {
+    int32_t size = static_cast<int32_t>(state()->medias()->size());
+    if (loudness_mode_ == noGain || index < 0 || index >= size) {
+      return std::nullopt;
+    }
+    std::shared_ptr<Media> media = state()->medias()->media(index);
+    g_loudness_scanner->Prepare(media);
+    int32_t next = NextIndex(true);
+    if (next >= 0 && next != index) {
+      g_loudness_scanner->Prepare(state()->medias()->media(next));
+    }
+    std::optional<Loudness> loudness = g_loudness_scanner->Get(media);
+    if (!loudness) return std::nullopt;
+    if (loudness_mode_ == albumGain) {
+      // Albums are runs of consecutive entries. Their loudness is combined
+      // by the scanner, the entry's own applies until it is known.
+      std::string album = LoudnessScanner::AlbumKey(media);
+      std::vector<std::shared_ptr<Media>> tracks{media};
+      for (int32_t step : {-1, 1}) {
+        for (int32_t other = index + step, count = 0;
+             other >= 0 && other < size && count < kAlbumWindow;
+             other += step, count++) {
+          std::shared_ptr<Media> neighbour = state()->medias()->media(other);
+          if (LoudnessScanner::AlbumKey(neighbour) != album) break;
+          tracks.emplace_back(neighbour);
+        }
+      }
+      std::optional<Loudness> combined =
+          g_loudness_scanner->GetCombined(tracks);
+      if (combined) loudness = combined;
+    }
+    return std::min(loudness_target_ - loudness->integrated,
+                    kTruePeakCeiling - loudness->true_peak);
+  }
+
+  // Opens entry |index| paused in |vlc_standby_player()|, so that its input is
+  // buffered & its first frame decoded by the time it has to be played.
+  void Prefetch(int32_t index) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    // |vlc_standby_player()| is still fading out the previous entry.
+    if (is_crossfading_) {
+      is_prefetch_requested_ = false;
+      return;
+    }
+    DiscardPrefetch();
+    if (index < 0 || index >= state()->medias()->size()) return;
+    // Not shared with |vlc_medias_|, the same entry may be open in both
+    // players & options must not leak into regular playback.
+    VLC::Media vlc_media(vlc_instance_,
+                         state()->medias()->media(index)->location(),
+                         VLC::Media::FromLocation);
+    vlc_media.addOption(":start-paused");
+    ApplyNormalization(vlc_standby_player(), index);
+    if (video_width_ > 0 && video_height_ > 0) {
+      int32_t standby = 1 - active_player_;
+      video_frame_buffers_[standby].reset(
+          new uint8_t[video_width_ * video_height_ * 4]);
+      SetVideoCallbacks(vlc_players_[standby], video_width_, video_height_);
+    }
+    vlc_standby_player().setMedia(vlc_media);
+    vlc_standby_player().play();
+    standby_index_ = index;
+  }
+
+  void DiscardPrefetch() {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    is_prefetch_requested_ = false;
+    if (standby_index_ < 0) return;
+    standby_index_ = -1;
+    vlc_standby_player().stop();
+  }
+
+  // Resumes the prefetched entry & makes |vlc_standby_player()| the active
+  // player. The previous entry keeps playing if |is_crossfade| is true.
+  void SwitchToStandby(bool is_crossfade = false) {
+    standby_index_ = -1;
+    is_crossfade_requested_ = false;
+    // Only the index changes, callbacks still running on the previous
+    // player keep writing to its own buffer.
+    active_player_ ^= 1;
+    if (audio_tap_) audio_tap_->Activate(vlc_media_player().get());
+    vlc_media_player().setPause(false);
+    if (!is_crossfade) vlc_standby_player().stop();
+    OnOpenCallback(vlc_media_player().media());
+  }
+
+  // Starts the prefetched entry silently & fades it in while the current one
+  // fades out, over the time left before the end of the current one (at most
+  // |crossfade_|). Volumes are ramped by |fader_| from the steady clock.
+  void StartCrossfade() {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    int32_t index = NextIndex(true);
+    if (index < 0 || index != standby_index_ ||
+        vlc_standby_player().state() != libvlc_Paused) {
+      is_crossfade_requested_ = false;
+      return;
+    }
+    int64_t remaining = vlc_media_player().length() - vlc_media_player().time();
+    int32_t duration = static_cast<int32_t>(
+        std::clamp<int64_t>(remaining, 0, crossfade_));
+    loop_watcher_.Stop();
+    ResetRecording();
+    if (is_shuffle_) shuffle_.Push(state()->index_);
+    state()->index_ = index;
+    is_prefetch_requested_ = false;
+    std::atomic_store(&keyframe_index_, {});
+    vlc_standby_player().setVolume(0);
+    SwitchToStandby(true);
+    is_crossfading_ = true;
+    VLC::MediaPlayer incoming = vlc_media_player();
+    VLC::MediaPlayer outgoing = vlc_standby_player();
+    Fader::Curve curve = crossfade_curve_;
+    fader_.Start(
+        duration,
+        [=](float progress) mutable -> void {
+          float volume = state()->volume() * 100;
+          incoming.setVolume(
+              static_cast<int32_t>(volume * Fader::Gain(curve, progress)));
+          outgoing.setVolume(
+              static_cast<int32_t>(volume * Fader::Gain(curve, 1 - progress)));
+        },
+        [=]() -> void {
+          worker_.Post([=]() -> void {
+            std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+            FinishCrossfade();
+          });
+        });
+  }
+
+  // Stops the faded out entry & restores the volume of both players.
+  void FinishCrossfade() {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    if (!is_crossfading_) return;
+    is_crossfading_ = false;
+    int32_t volume = static_cast<int32_t>(state()->volume_ * 100);
+    vlc_standby_player().stop();
+    vlc_standby_player().setVolume(volume);
+    vlc_media_player().setVolume(volume);
+  }
+
+  void CancelCrossfade() {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    if (!is_crossfading_) return;
+    fader_.Cancel();
+    FinishCrossfade();
+  }
+
+  // Returns the entry following the current one according to
+  // |playlist_mode_|, or -1 at the end of the playlist. |is_automatic| is
+  // true when the current entry has ended by itself.
+  int32_t NextIndex(bool is_automatic) {
+    int32_t index = state()->index_;
+    int32_t size = static_cast<int32_t>(state()->medias()->size());
+    if (is_automatic && playlist_mode_ == PlaylistMode::repeat) return index;
+    if (is_shuffle_) {
+      return shuffle_.Next(index, playlist_mode_ == PlaylistMode::loop);
+    }
+    if (index + 1 < size) return index + 1;
+    return playlist_mode_ == PlaylistMode::loop && size > 0 ? 0 : -1;
+  }
+
+  int32_t PreviousIndex() {
+    int32_t index = state()->index_;
+    int32_t size = static_cast<int32_t>(state()->medias()->size());
+    if (is_shuffle_) {
+      return shuffle_.Previous(index, playlist_mode_ == PlaylistMode::loop);
+    }
+    if (index > 0) return index - 1;
+    return playlist_mode_ == PlaylistMode::loop && size > 0 ? size - 1 : -1;
+  }
+
   std::function<void()> playlist_callback_ = [=]() -> void {};
 
+  // Called after the entries were modified.
   void OnPlaylistCallback() {
-    if (is_playlist_modified_) {
-      vlc_media_list_player_.setMediaList(vlc_media_list_);
-      if (!vlc_media_list_.count()) {
-        state()->Reset();
-        vlc_media_list_player_.stop();
-        return;
-      }
-      if (state()->index_ > vlc_media_list_.count())
-        state()->index_ = vlc_media_list_.count() - 1;
-      is_playlist_modified_ = false;
-      playlist_callback_();
-    };
+    // Indices of the created medias may have shifted.
+    vlc_medias_.clear();
+    DiscardPrefetch();
+    int32_t size = static_cast<int32_t>(state()->medias()->size());
+    if (!size) {
+      state()->Reset();
+      vlc_media_player().stop();
+      return;
+    }
+    if (state()->index_ >= size) state()->index_ = size - 1;
+    playlist_callback_();
+    state()->ClearChanged();
   }
 
   std::function<void(VLC::Media)> open_callback_ = [=](VLC::Media) -> void {};
 
   void OnOpenCallback(VLC::MediaPtr vlc_media_ptr) {
-    state()->is_playing_ = vlc_media_player_.isPlaying();
-    state()->is_valid_ = vlc_media_player_.isValid();
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    state()->is_playing_ = vlc_media_player().isPlaying();
+    state()->is_valid_ = vlc_media_player().isValid();
     if (duration() > 0) {
       state()->is_completed_ = false;
       state()->position_ = position();
@@ -109,8 +479,8 @@ class PlayerEvents : public PlayerGetters {
       state()->position_ = 0;
       state()->duration_ = 0;
     }
-    state()->index_ = vlc_media_list_.indexOfItem(*vlc_media_ptr.get());
     open_callback_(*vlc_media_ptr.get());
+    state()->ClearChanged();
   }
 
   std::function<void(int32_t, int32_t)> video_dimension_callback_ = [=](
@@ -125,7 +495,7 @@ class PlayerEvents : public PlayerGetters {
       video_height = preferred_video_height_.value_or(0);
     } else {
       uint32_t px = 0, py = 0;
-      libvlc_video_get_size(vlc_media_player_.get(), 0, &px, &py);
+      libvlc_video_get_size(vlc_media_player().get(), 0, &px, &py);
       video_width = static_cast<int32_t>(px);
       video_height = static_cast<int32_t>(py);
     }
@@ -133,36 +503,45 @@ class PlayerEvents : public PlayerGetters {
     if (video_width_ != video_width || video_height_ != video_height) {
       video_width_ = video_width;
       video_height_ = video_height;
-      int32_t pitch = video_width * 4;
-      int32_t size = video_height * pitch;
-      video_frame_buffer_.reset(new uint8_t[size]);
-      vlc_media_player_.setVideoCallbacks(
-          std::bind(&PlayerEvents::OnVideoLockCallback, this,
-                    std::placeholders::_1),
-          nullptr, std::bind(&PlayerEvents::OnVideoPictureCallback, this,
-                             std::placeholders::_1));
-      vlc_media_player_.setVideoFormatCallbacks(
-          [=](char* chroma, uint32_t* w, uint32_t* h, uint32_t* p,
-              uint32_t* l) -> int32_t {
-            strcpy(chroma, "RGBA");
-            *w = video_width;
-            *h = video_height;
-            *p = pitch;
-            *l = video_height;
-            return 1;
-          },
-          nullptr);
-      vlc_media_player_.setVideoFormat("RGBA", video_width, video_height,
-                                       pitch);
+      int32_t size = video_height * video_width * 4;
+      int32_t active = active_player_;
+      video_frame_buffers_[active].reset(new uint8_t[size]);
+      SetVideoCallbacks(vlc_players_[active], video_width, video_height);
     }
   }
 
+  void SetVideoCallbacks(VLC::MediaPlayer& player, int32_t video_width,
+                         int32_t video_height) {
+    int32_t pitch = video_width * 4;
+    libvlc_media_player_t* raw_player = player.get();
+    player.setVideoCallbacks(
+        [=](void** planes) -> void* {
+          return OnVideoLockCallback(raw_player, planes);
+        },
+        nullptr,
+        [=](void* picture) -> void {
+          if (IsActive(raw_player)) OnVideoPictureCallback(raw_player);
+        });
+    player.setVideoFormatCallbacks(
+        [=](char* chroma, uint32_t* w, uint32_t* h, uint32_t* p,
+            uint32_t* l) -> int32_t {
+          strcpy(chroma, "RGBA");
+          *w = video_width;
+          *h = video_height;
+          *p = pitch;
+          *l = video_height;
+          return 1;
+        },
+        nullptr);
+    player.setVideoFormat("RGBA", video_width, video_height, pitch);
+  }
+
   std::function<void()> play_callback_ = [=]() -> void {};
 
   void OnPlayCallback() {
-    state()->is_playing_ = vlc_media_player_.isPlaying();
+    state()->is_playing_ = vlc_media_player().isPlaying();
     if (duration() > 0) {
-      state()->is_valid_ = vlc_media_player_.isValid();
+      state()->is_valid_ = vlc_media_player().isValid();
       state()->is_completed_ = false;
       state()->position_ = position();
       state()->duration_ = duration();
@@ -173,10 +552,10 @@ class PlayerEvents : public PlayerGetters {
   std::function<void()> pause_callback_ = [=]() -> void {};
 
   void OnPauseCallback() {
-    state()->is_playing_ = vlc_media_player_.isPlaying();
+    state()->is_playing_ = vlc_media_player().isPlaying();
     if (duration() > 0) {
       state()->position_ = position();
-      state()->is_valid_ = vlc_media_player_.isValid();
+      state()->is_valid_ = vlc_media_player().isValid();
       state()->duration_ = duration();
     }
     pause_callback_();
@@ -185,8 +564,8 @@ class PlayerEvents : public PlayerGetters {
   std::function<void()> stop_callback_ = [=]() -> void {};
 
   void OnStopCallback() {
-    state()->is_playing_ = vlc_media_player_.isPlaying();
-    state()->is_valid_ = vlc_media_player_.isValid();
+    state()->is_playing_ = vlc_media_player().isPlaying();
+    state()->is_valid_ = vlc_media_player().isValid();
     state()->position_ = 0;
     state()->duration_ = 0;
     stop_callback_();
@@ -196,14 +575,127 @@ class PlayerEvents : public PlayerGetters {
       int32_t position) -> void {};
 
   void OnPositionCallback(float relative_position) {
-    state()->is_playing_ = vlc_media_player_.isPlaying();
+    state()->is_playing_ = vlc_media_player().isPlaying();
     if (duration() > 0) {
       state()->position_ = position();
-      state()->is_valid_ = vlc_media_player_.isValid();
+      state()->is_valid_ = vlc_media_player().isValid();
       state()->duration_ = duration();
     }
     position_callback_(
-        static_cast<int32_t>(relative_position * vlc_media_player_.length()));
+        static_cast<int32_t>(relative_position * vlc_media_player().length()));
+    int64_t end_reached_time = end_reached_time_.exchange(0);
+    if (end_reached_time) {
+      gapless_callback_(state()->index_, Now() - end_reached_time);
+    }
+    int64_t length = vlc_media_player().length();
+    if (length <= 0) return;
+    int64_t remaining = length - vlc_media_player().time();
+    int32_t index = state()->index_;
+    int32_t prefetch =
+        std::max<int32_t>(gapless_prefetch_,
+                          crossfade_ > 0 ? crossfade_ + kCrossfadePrefetch : 0);
+    if (prefetch > 0 && !is_prefetch_requested_ && remaining <= prefetch) {
+      is_prefetch_requested_ = true;
+      worker_.Post([=]() -> void {
+        std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+        if (state()->index_ == index) Prefetch(NextIndex(true));
+      });
+    }
+    if (crossfade_ > 0 && !is_crossfade_requested_ && standby_index_ >= 0 &&
+        remaining <= crossfade_) {
+      is_crossfade_requested_ = true;
+      worker_.Post([=]() -> void {
+        std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+        if (state()->index_ == index) StartCrossfade();
+      });
+    }
+  }
+
+  std::function<void(int32_t, int64_t)> gapless_callback_ = [=](
+      int32_t, int64_t) -> void {};
+
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  SeekCallback seek_callback_ = [=](int64_t, int64_t, int64_t,
+                                    int32_t) -> void {};
+
+  std::function<void(int32_t)> loop_callback_ = [=](int32_t) -> void {};
+
+  std::function<void(bool, const std::string&)> recording_callback_ =
+      [=](bool, const std::string&) -> void {};
+
+  std::function<void(int32_t, int32_t)> audio_format_callback_ =
+      [=](int32_t, int32_t) -> void {};
+
+  std::function<void(const AudioAnalyzer::Analysis&)> analysis_callback_ =
+      [=](const AudioAnalyzer::Analysis&) -> void {};
+
+  void IssueSeek(SeekScheduler::Seek seek) {
+    seek_mode_ = seek.mode;
+    seek_target_ = seek.time;
+    int64_t time = seek.time;
+    // Land exactly on the closest preceding keyframe, so that decoding
+    // resumes from it without frames decoded & dropped up to the target.
+    if (seek.mode == SeekMode::fast) {
+      std::shared_ptr<const KeyframeIndex> index = CurrentKeyframeIndex();
+      const Keyframe* keyframe = index ? index->Find(seek.time) : nullptr;
+      if (keyframe) time = keyframe->time;
+    }
+    auto milliseconds = static_cast<libvlc_time_t>((time + 500) / 1000);
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    libvlc_media_player_set_time(vlc_media_player().get(), milliseconds,
+                                 seek.mode == SeekMode::fast);
+#else
+    vlc_media_player().setTime(milliseconds);
+#endif
+  }
+
+  // Returns the keyframe index of the current entry, empty if it was never
+  // built.
+  std::shared_ptr<const KeyframeIndex> CurrentKeyframeIndex() {
+    std::shared_ptr<const KeyframeIndex> index =
+        std::atomic_load(&keyframe_index_);
+    if (index) return index;
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    int32_t current = state()->index_;
+    if (current < 0 || current >= state()->medias()->size()) return nullptr;
+    index = g_keyframe_indexer->Get(state()->medias()->media(current));
+    // An empty index avoids reading the cache again on every seek.
+    if (!index) index = std::make_shared<const KeyframeIndex>();
+    std::atomic_store(&keyframe_index_, index);
+    return index;
+  }
+
+  // Returns the duration of a video frame in microseconds, or of a 25 fps
+  // frame if the frame rate is unknown.
+  int64_t FrameDuration() {
+    float fps = libvlc_media_player_get_fps(vlc_media_player().get());
+    return static_cast<int64_t>(1000000 / (fps > 0 ? fps : 25.0f));
+  }
+
+  // libVLC has no event for completed seeks. A seek is considered complete
+  // at the first time update after it for |fast| seeks, & at the first one
+  // within a frame (or |kSeekTolerance|) of the target for |precise| ones.
+  void OnTimeCallback(libvlc_time_t time) {
+    int64_t target = seek_target_;
+    if (target < 0) return;
+    int64_t reached = static_cast<int64_t>(time) * 1000;
+    int64_t tolerance = std::max(FrameDuration(), kSeekTolerance);
+    if (seek_mode_ != SeekMode::fast &&
+        std::abs(reached - target) > tolerance) {
+      return;
+    }
+    if (!seek_target_.compare_exchange_strong(target, -1)) return;
+    SeekScheduler::Result result = seek_scheduler_.Complete();
+    seek_callback_(target, reached, result.latency, result.dropped);
+    if (result.next) {
+      SeekScheduler::Seek next = *result.next;
+      worker_.Post([=]() -> void { IssueSeek(next); });
+    }
   }
 
   std::function<void(bool)> seekable_callback_ = [=](bool) -> void {};
@@ -218,13 +710,12 @@ class PlayerEvents : public PlayerGetters {
   std::function<void()> complete_callback_ = [=]() -> void {};
 
   void OnCompleteCallback() {
-    state()->is_playing_ = vlc_media_player_.isPlaying();
+    state()->is_playing_ = vlc_media_player().isPlaying();
     if (duration() > 0) {
-      state()->is_valid_ = vlc_media_player_.isValid();
+      state()->is_valid_ = vlc_media_player().isValid();
       state()->is_completed_ = true;
       state()->position_ = position();
       state()->duration_ = duration();
-      OnPlaylistCallback();
       complete_callback_();
     } else {
       state()->position_ = 0;
@@ -232,20 +723,39 @@ class PlayerEvents : public PlayerGetters {
     }
   }
 
+  void OnEndReachedCallback() {
+    end_reached_time_ = Now();
+    OnCompleteCallback();
+    int32_t index = state()->index_;
+    worker_.Post([=]() -> void {
+      std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+      // Another entry may have been opened in the meantime.
+      if (state()->index_ != index ||
+          vlc_media_player().state() != libvlc_Ended) {
+        return;
+      }
+      int32_t next = NextIndex(true);
+      if (next < 0) end_reached_time_ = 0;
+      PlayIndex(next);
+    });
+  }
+
   std::function<void(float)> volume_callback_ = [=](float) -> void {};
 
   std::function<void(float)> rate_callback_ = [=](float) -> void {};
 
   VideoFrameCallback video_callback_;
 
-  void* OnVideoLockCallback(void** planes) {
-    planes[0] = static_cast<void*>(video_frame_buffer_.get());
+  void* OnVideoLockCallback(libvlc_media_player_t* player, void** planes) {
+    // The standby player decodes its first frame ahead of time.
+    planes[0] = static_cast<void*>(video_frame_buffers_[IndexOf(player)].get());
     return nullptr;
   }
 
-  void OnVideoPictureCallback(void* picture) {
+  void OnVideoPictureCallback(libvlc_media_player_t* player) {
     if (video_callback_) {
-      video_callback_(video_frame_buffer_.get(), video_width_, video_height_);
+      video_callback_(video_frame_buffers_[IndexOf(player)].get(),
+                      video_width_, video_height_);
     }
   }
 };
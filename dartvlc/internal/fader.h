@@ -0,0 +1,92 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_FADER_H_
+#define INTERNAL_FADER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Drives a ramp from its own thread, reporting the progress computed from the
+// steady clock, so that late ticks never stretch the ramp.
+class Fader {
+ public:
+  static constexpr auto kInterval = std::chrono::milliseconds(10);
+
+  enum Curve : int32_t { linear, equalPower };
+
+  // Returns the gain of a fade in at |progress| following |curve|. The gain
+  // of the matching fade out is |Gain(curve, 1 - progress)|.
+  static float Gain(Curve curve, float progress) {
+    if (curve == equalPower) {
+      // M_PI is not defined by MSVC without _USE_MATH_DEFINES.
+      return std::sin(progress * 1.57079632679f);
+    }
+    return progress;
+  }
+
+  ~Fader() { Cancel(); }
+
+  // Calls |step| with the progress in [0, 1] every |kInterval| during
+  // |duration| milliseconds, then |done|. Both are called from the fader's
+  // thread. A running ramp is cancelled first.
+  void Start(int32_t duration, std::function<void(float)> step,
+             std::function<void()> done) {
+    Cancel();
+    is_cancelled_ = false;
+    thread_ = std::thread([=]() -> void {
+      auto start = std::chrono::steady_clock::now();
+      auto end = start + std::chrono::milliseconds(duration);
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (true) {
+        auto now = std::chrono::steady_clock::now();
+        float progress =
+            duration > 0
+                ? std::chrono::duration<float, std::milli>(now - start)
+                          .count() /
+                      duration
+                : 1.0f;
+        step(std::min(progress, 1.0f));
+        if (now >= end) break;
+        if (condition_.wait_until(lock, std::min(now + kInterval, end),
+                                  [this]() { return is_cancelled_; })) {
+          return;
+        }
+      }
+      lock.unlock();
+      done();
+    });
+  }
+
+  // Stops the running ramp without calling its |done|. Must not be called
+  // from |step| or |done|.
+  void Cancel() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_cancelled_ = true;
+    }
+    condition_.notify_all();
+    if (thread_.joinable()) thread_.join();
+  }
+
+ private:
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool is_cancelled_ = false;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_FFT_H_
+#define INTERNAL_FFT_H_
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// In-place iterative radix-2 FFT of a fixed power of two size. Twiddles & the
+// bit reversal permutation are computed once, real & imaginary parts are kept
+// in separate arrays so that the butterflies vectorize.
+class Fft {
+ public:
+  // |size| must be a power of two.
+  explicit Fft(int32_t size) : size_(size) {
+    int32_t bits = 0;
+    while ((1 << bits) < size_) bits++;
+    reversed_.resize(size_);
+    for (int32_t index = 0; index < size_; index++) {
+      int32_t reversed = 0;
+      for (int32_t bit = 0; bit < bits; bit++) {
+        reversed |= ((index >> bit) & 1) << (bits - 1 - bit);
+      }
+      reversed_[index] = reversed;
+    }
+    cos_.resize(size_ / 2);
+    sin_.resize(size_ / 2);
+    for (int32_t index = 0; index < size_ / 2; index++) {
+      double angle = -2.0 * 3.14159265358979323846 * index / size_;
+      cos_[index] = static_cast<float>(std::cos(angle));
+      sin_[index] = static_cast<float>(std::sin(angle));
+    }
+  }
+
+  int32_t size() const { return size_; }
+
+  // Transforms |real| & |imaginary|, both of |size()| elements.
+  void Transform(float* real, float* imaginary) const {
+    for (int32_t index = 0; index < size_; index++) {
+      int32_t reversed = reversed_[index];
+      if (index < reversed) {
+        std::swap(real[index], real[reversed]);
+        std::swap(imaginary[index], imaginary[reversed]);
+      }
+    }
+    for (int32_t length = 2; length <= size_; length <<= 1) {
+      int32_t half = length / 2;
+      int32_t stride = size_ / length;
+      for (int32_t start = 0; start < size_; start += length) {
+        float* even_real = real + start;
+        float* even_imaginary = imaginary + start;
+        float* odd_real = even_real + half;
+        float* odd_imaginary = even_imaginary + half;
+        for (int32_t index = 0; index < half; index++) {
+          float twiddle_real = cos_[index * stride];
+          float twiddle_imaginary = sin_[index * stride];
+          float product_real = odd_real[index] * twiddle_real -
+                               odd_imaginary[index] * twiddle_imaginary;
+          float product_imaginary = odd_real[index] * twiddle_imaginary +
+                                    odd_imaginary[index] * twiddle_real;
+          odd_real[index] = even_real[index] - product_real;
+          odd_imaginary[index] = even_imaginary[index] - product_imaginary;
+          even_real[index] += product_real;
+          even_imaginary[index] += product_imaginary;
+        }
+      }
+    }
+  }
+
+ private:
+  int32_t size_;
+  std::vector<int32_t> reversed_;
+  std::vector<float> cos_;
+  std::vector<float> sin_;
+};
+
+#endif
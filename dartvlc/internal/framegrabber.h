@@ -0,0 +1,189 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_FRAMEGRABBER_H_
+#define INTERNAL_FRAMEGRABBER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vlcpp/vlc.hpp>
+
+// Decodes frames of a media without any output, scaled (keeping the aspect
+// ratio) to fit inside |max_width| x |max_height| as RGBA. Used for artwork &
+// thumbnail generation.
+class FrameGrabber {
+ public:
+  int32_t width() const { return width_; }
+  int32_t height() const { return height_; }
+  const std::vector<uint8_t>& frame() const { return frame_; }
+
+  FrameGrabber(const std::string& location, int32_t max_width,
+               int32_t max_height,
+               const std::vector<std::string>& options = {}) {
+    VLC::Media media =
+        VLC::Media(Instance(), location, VLC::Media::FromLocation);
+    for (const std::string& option : options) media.addOption(option);
+    vlc_media_player_ = VLC::MediaPlayer(media);
+    vlc_media_player_.setVideoFormatCallbacks(
+        [=](char* chroma, uint32_t* w, uint32_t* h, uint32_t* p,
+            uint32_t* l) -> int32_t {
+          float scale = std::min(
+              {1.0f, static_cast<float>(max_width) / std::max(*w, 1u),
+               static_cast<float>(max_height) / std::max(*h, 1u)});
+          std::lock_guard<std::mutex> lock(mutex_);
+          width_ = std::max(1, static_cast<int32_t>(*w * scale));
+          height_ = std::max(1, static_cast<int32_t>(*h * scale));
+          buffer_.resize(width_ * height_ * 4);
+          memcpy(chroma, "RGBA", 4);
+          *w = width_;
+          *h = height_;
+          *p = width_ * 4;
+          *l = height_;
+          return 1;
+        },
+        nullptr);
+    vlc_media_player_.setVideoCallbacks(
+        [=](void** planes) -> void* {
+          planes[0] = static_cast<void*>(buffer_.data());
+          return nullptr;
+        },
+        nullptr,
+        [=](void*) -> void {
+          std::lock_guard<std::mutex> lock(mutex_);
+          frame_ = buffer_;
+          frame_serial_++;
+          condition_.notify_all();
+        });
+    vlc_media_player_.eventManager().onEndReached([=]() -> void {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_ended_ = true;
+      condition_.notify_all();
+    });
+    vlc_media_player_.eventManager().onEncounteredError([=]() -> void {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_ended_ = true;
+      condition_.notify_all();
+    });
+  }
+
+  ~FrameGrabber() { vlc_media_player_.stop(); }
+
+  // Waits for a frame displayed at or after |time| - |tolerance| milliseconds
+  // & stores it in |frame_|. Returns false if no such frame was decoded
+  // within |timeout| milliseconds or the media ended.
+  bool Grab(int64_t time = 0, int64_t tolerance = 0, int64_t timeout = 5000) {
+    uint64_t serial;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      serial = frame_serial_;
+    }
+    if (!is_started_) {
+      vlc_media_player_.play();
+      is_started_ = true;
+    }
+    if (time > 0) vlc_media_player_.setTime(time);
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(timeout);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      if (!condition_.wait_until(lock, deadline, [&]() {
+            return is_ended_ || frame_serial_ != serial;
+          })) {
+        return false;
+      }
+      if (frame_serial_ == serial) return false;
+      serial = frame_serial_;
+      lock.unlock();
+      // Queried outside of the video callbacks, libVLC must not be called back
+      // into from the video output thread.
+      bool is_reached = vlc_media_player_.time() >= time - tolerance;
+      lock.lock();
+      if (is_reached) return true;
+    }
+  }
+
+  // Writes |frame_| as an uncompressed 32-bit BMP, which Flutter can decode
+  // without any further processing.
+  bool Save(const std::filesystem::path& path) const {
+    return SaveBitmap(path, frame_.data(), width_, height_);
+  }
+
+  static bool SaveBitmap(const std::filesystem::path& path,
+                         const uint8_t* rgba, int32_t width, int32_t height) {
+    uint32_t image_size = width * height * 4;
+    uint8_t header[54] = {'B', 'M'};
+    auto put = [&](size_t offset, uint32_t value) {
+      for (int32_t i = 0; i < 4; i++) header[offset + i] = value >> (8 * i);
+    };
+    put(2, 54 + image_size);
+    put(10, 54);
+    put(14, 40);
+    put(18, width);
+    // Negative height for top-down rows.
+    put(22, static_cast<uint32_t>(-height));
+    header[26] = 1;
+    header[28] = 32;
+    put(34, image_size);
+    std::vector<uint8_t> bgra(rgba, rgba + image_size);
+    for (uint32_t i = 0; i < image_size; i += 4) {
+      std::swap(bgra[i], bgra[i + 2]);
+    }
+    // Unique, as workers may resize the same artwork at once.
+    static std::atomic<uint32_t> counter = 0;
+    auto temporary = path;
+    temporary += ".tmp" + std::to_string(counter++);
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char*>(header), sizeof(header));
+      file.write(reinterpret_cast<const char*>(bgra.data()), bgra.size());
+      if (!file) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+      std::error_code ignored;
+      std::filesystem::remove(temporary, ignored);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  // Shared by all grabbers, so that plugins are only loaded once.
+  static VLC::Instance& Instance() {
+    static const char* kArguments[] = {"--no-audio", "--no-osd", "--no-spu",
+                                       "--no-video-title-show"};
+    static VLC::Instance instance = VLC::Instance(
+        sizeof(kArguments) / sizeof(kArguments[0]), kArguments);
+    return instance;
+  }
+
+  VLC::MediaPlayer vlc_media_player_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<uint8_t> buffer_;
+  std::vector<uint8_t> frame_;
+  uint64_t frame_serial_ = 0;
+  int32_t width_ = 0;
+  int32_t height_ = 0;
+  bool is_started_ = false;
+  bool is_ended_ = false;
+};
+
+#endif
@@ -20,19 +20,26 @@ class PlayerGetters : public PlayerInternal {
   PlayerState* state() const { return state_.get(); }
 
   int32_t duration() {
-    return static_cast<int32_t>(vlc_media_player_.length());
+    return static_cast<int32_t>(vlc_media_player().length());
   }
 
   int32_t position() {
-    return static_cast<int32_t>(vlc_media_player_.length() *
-                                vlc_media_player_.position());
+    return static_cast<int32_t>(vlc_media_player().length() *
+                                vlc_media_player().position());
   }
 
-  float volume() { return vlc_media_player_.volume() / 100.0f; }
+  float volume() { return vlc_media_player().volume() / 100.0f; }
 
-  float rate() { return vlc_media_player_.rate(); }
+  float rate() { return vlc_media_player().rate(); }
 
-  bool is_playing() { return vlc_media_player_.isPlaying(); }
+  bool is_playing() { return vlc_media_player().isPlaying(); }
 
-  bool is_paused() { return !vlc_media_player_.isPlaying(); }
+  bool is_paused() { return !vlc_media_player().isPlaying(); }
+
+  // Latest audio analysis, see |PlayerSetters::SetAnalysis|.
+  AudioAnalyzer::Analysis analysis() {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    return audio_analyzer_ ? audio_analyzer_->Snapshot()
+                           : AudioAnalyzer::Analysis();
+  }
 };
@@ -9,22 +9,130 @@
  * GNU Lesser General Public License v2.1
  */
 
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <vlcpp/vlc.hpp>
 
+#include "equalizer.h"
+#include "internal/audioanalyzer.h"
+#include "internal/audiopassthrough.h"
+#include "internal/audiotap.h"
+#include "internal/fader.h"
+#include "internal/loopwatcher.h"
+#include "internal/seekscheduler.h"
+#include "internal/shuffleorder.h"
 #include "internal/state.h"
+#include "internal/threadpool.h"
+#include "keyframes.h"
+#include "loudness.h"
+#include "mediasource/playlist.h"
 
 class PlayerInternal {
  protected:
+  // Number of entries on each side of the current one for which a |VLC::Media|
+  // is kept around.
+  static constexpr int32_t kMediaWindow = 2;
+  // Milliseconds, on top of the crossfade, before the end of an entry at which
+  // the next one is prefetched when crossfading.
+  static constexpr int32_t kCrossfadePrefetch = 5000;
+  // Microseconds from its target at which a precise seek is considered
+  // complete, for medias without video.
+  static constexpr int64_t kSeekTolerance = 50000;
+  // Frames held by the audio tap enabled for |PlayerSetters::SetAnalysis|,
+  // which nothing else may read.
+  static constexpr int32_t kAnalysisTapCapacity = 4096;
+  // Highest true peak in dBTP normalized entries may reach.
+  static constexpr double kTruePeakCeiling = -1.0;
+  // Entries on each side of the current one looked at for the loudness of
+  // its album.
+  static constexpr int32_t kAlbumWindow = 64;
+
   VLC::Instance vlc_instance_;
-  VLC::MediaPlayer vlc_media_player_;
-  VLC::MediaListPlayer vlc_media_list_player_;
-  VLC::MediaList vlc_media_list_;
+  // Created once & never reassigned, as the event & vout threads of libVLC
+  // refer to both at any time. The standby one prepares the entry following
+  // the current one for gapless transitions & both exchange their roles once
+  // it starts, see |PlayerEvents::Prefetch|.
+  VLC::MediaPlayer vlc_players_[2];
+  // Index in |vlc_players_| of the player whose events are forwarded.
+  std::atomic<int32_t> active_player_ = 0;
+  // Entry prepared by |vlc_standby_player()|, or -1.
+  std::atomic<int32_t> standby_index_ = -1;
+  std::atomic<bool> is_prefetch_requested_ = false;
+  // Milliseconds before the end of an entry at which the next one is
+  // prepared, 0 disables gapless playback.
+  std::atomic<int32_t> gapless_prefetch_ = 0;
+  // Length of the crossfade between consecutive entries in milliseconds, 0
+  // disables crossfades.
+  std::atomic<int32_t> crossfade_ = 0;
+  Fader::Curve crossfade_curve_ = Fader::linear;
+  std::atomic<bool> is_crossfade_requested_ = false;
+  // Whether |vlc_standby_player()| is fading out the previous entry.
+  bool is_crossfading_ = false;
+  Fader fader_;
+  // Target in microseconds of the seek in progress, -1 if none.
+  std::atomic<int64_t> seek_target_ = -1;
+  std::atomic<SeekMode> seek_mode_ = SeekMode::precise;
+  SeekScheduler seek_scheduler_;
+  // Wraps the loop region around, see |PlayerSetters::SetLoopRegion|.
+  LoopWatcher loop_watcher_;
+  // Replaces the audio output once enabled, see
+  // |PlayerSetters::EnableAudioTap|.
+  std::unique_ptr<AudioTap> audio_tap_;
+  // Play the samples tapped from the player at the same index in
+  // |vlc_players_| when requested, see |PlayerSetters::EnableAudioTap|.
+  std::unique_ptr<AudioPassthrough> audio_passthroughs_[2];
+  // Fed by |audio_tap_|, see |PlayerSetters::SetAnalysis|.
+  std::unique_ptr<AudioAnalyzer> audio_analyzer_;
+  // Set by |PlayerSetters::SetEqualizer|, normalization gains are applied
+  // on top of its preamp.
+  std::optional<Equalizer> equalizer_;
+  LoudnessMode loudness_mode_ = noGain;
+  // LUFS.
+  double loudness_target_ = -18.0;
+  // File written by |PlayerSetters::StartRecording|, empty if none.
+  std::string recording_path_;
+  // Loaded on the first fast seek of an entry, accessed atomically.
+  std::shared_ptr<const KeyframeIndex> keyframe_index_;
+  // Steady clock time in microseconds at which the last entry ended, until
+  // the next one starts. 0 otherwise.
+  std::atomic<int64_t> end_reached_time_ = 0;
+  // Medias created for the entries around the current index, see
+  // |PlayerEvents::MediaAt|.
+  std::map<int32_t, VLC::Media> vlc_medias_;
+  PlaylistMode playlist_mode_ = PlaylistMode::single;
+  // Play order used instead of the playlist's when |is_shuffle_| is true.
+  ShuffleOrder shuffle_;
+  bool is_shuffle_ = false;
+  uint64_t shuffle_seed_ = 0;
+  // Guards playlist navigation, which happens both on the caller's thread &
+  // on |worker_|.
+  std::recursive_mutex playlist_mutex_;
+  // Runs work triggered by libVLC events, which must not call back into
+  // libVLC from the event thread.
+  ThreadPool worker_{1};
   std::unique_ptr<PlayerState> state_ = nullptr;
-  std::unique_ptr<uint8_t> video_frame_buffer_ = nullptr;
+  // Written by the vout of the player at the same index in |vlc_players_|.
+  std::unique_ptr<uint8_t> video_frame_buffers_[2];
   int32_t video_width_ = 0;
   int32_t video_height_ = 0;
   std::optional<int32_t> preferred_video_width_ = std::nullopt;
   std::optional<int32_t> preferred_video_height_ = std::nullopt;
-  bool is_playlist_modified_ = false;
+
+  VLC::MediaPlayer& vlc_media_player() { return vlc_players_[active_player_]; }
+
+  VLC::MediaPlayer& vlc_standby_player() {
+    return vlc_players_[1 - active_player_];
+  }
+
+  // Index of |player| in |vlc_players_|.
+  int32_t IndexOf(libvlc_media_player_t* player) const {
+    return player == vlc_players_[1].get() ? 1 : 0;
+  }
+
+  bool IsActive(libvlc_media_player_t* player) const {
+    return IndexOf(player) == active_player_;
+  }
 };
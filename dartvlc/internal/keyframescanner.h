@@ -0,0 +1,341 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_KEYFRAMESCANNER_H_
+#define INTERNAL_KEYFRAMESCANNER_H_
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct Keyframe {
+  // Microseconds since the first frame.
+  int64_t time;
+};
+
+// Finds the keyframes of MPEG-TS & AVI files by walking their containers,
+// without decoding anything. Keyframes are recognized from container flags
+// when present & otherwise from the start of the coded picture (H.264 &
+// HEVC IDR/IRAP NAL units, MPEG-1/2 sequence & GOP headers, MPEG-4 part 2
+// I-VOPs).
+class KeyframeScanner {
+ public:
+  static std::optional<std::vector<Keyframe>> Scan(
+      const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return std::nullopt;
+    uint8_t header[400] = {};
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    file.clear();
+    file.seekg(0);
+    if (memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "AVI ", 4) == 0) {
+      return ScanAvi(file);
+    }
+    if (header[0] == 0x47 && header[188] == 0x47 && header[376] == 0x47) {
+      return ScanTs(file, 188, 0);
+    }
+    // M2TS, packets are prefixed with a 4 byte timecode.
+    if (header[4] == 0x47 && header[196] == 0x47 && header[388] == 0x47) {
+      return ScanTs(file, 192, 4);
+    }
+    return std::nullopt;
+  }
+
+ private:
+  enum Codec { unknown, mpeg2, mpeg4, h264, hevc, mjpeg };
+
+  static constexpr size_t kBufferSize = 1 << 20;
+
+  // Returns true if |data| starts a keyframe of |codec|.
+  static bool IsKeyframe(Codec codec, const uint8_t* data, size_t size) {
+    if (codec == mjpeg) return true;
+    for (size_t i = 0; i + 4 < size; i++) {
+      if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) continue;
+      uint8_t code = data[i + 3];
+      switch (codec) {
+        case mpeg2:
+          // Sequence header or GOP.
+          if (code == 0xB3 || code == 0xB8) return true;
+          break;
+        case mpeg4:
+          // Visual object sequence, GOV, or VOP with an I coding type.
+          if (code == 0xB0 || code == 0xB3) return true;
+          if (code == 0xB6) return (data[i + 4] >> 6) == 0;
+          break;
+        case h264:
+          // IDR slice or SPS, which encoders emit before open-GOP I frames.
+          if ((code & 0x1F) == 5 || (code & 0x1F) == 7) return true;
+          break;
+        case hevc: {
+          uint8_t type = (code >> 1) & 0x3F;
+          // IRAP slices & parameter sets.
+          if ((type >= 16 && type <= 21) || (type >= 32 && type <= 34)) {
+            return true;
+          }
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+    return false;
+  }
+
+  static std::vector<Keyframe> ScanTs(std::ifstream& file,
+                                      size_t packet_size, size_t prefix) {
+    std::vector<Keyframe> keyframes;
+    std::vector<uint8_t> buffer(kBufferSize / packet_size * packet_size);
+    int32_t pmt_pid = -1, video_pid = -1;
+    Codec codec = unknown;
+    int64_t first_pts = -1, last_pts = -1, wraps = 0;
+    while (file) {
+      file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+      size_t read = static_cast<size_t>(file.gcount());
+      for (size_t start = 0; start + packet_size <= read;
+           start += packet_size) {
+        const uint8_t* packet = buffer.data() + start + prefix;
+        if (packet[0] != 0x47) continue;
+        int32_t pid = ((packet[1] & 0x1F) << 8) | packet[2];
+        bool is_unit_start = packet[1] & 0x40;
+        uint8_t adaptation = (packet[3] >> 4) & 0x3;
+        size_t position = 4;
+        bool is_random_access = false;
+        if (adaptation & 0x2) {
+          uint8_t length = packet[4];
+          if (length > 0) is_random_access = packet[5] & 0x40;
+          position = 5 + length;
+        }
+        if (!(adaptation & 0x1) || !is_unit_start || position >= 188) {
+          continue;
+        }
+        const uint8_t* payload = packet + position;
+        size_t size = 188 - position;
+        if (pid == 0) {
+          pmt_pid = ParsePat(payload, size);
+        } else if (pid == pmt_pid && video_pid < 0) {
+          video_pid = ParsePmt(payload, size, codec);
+        } else if (pid == video_pid && size > 14 && payload[0] == 0 &&
+                   payload[1] == 0 && payload[2] == 1) {
+          uint8_t flags = payload[7];
+          size_t header_size = 9 + payload[8];
+          if (!(flags & 0x80) || header_size >= size) continue;
+          int64_t pts = (static_cast<int64_t>(payload[9] & 0x0E) << 29) |
+                        (payload[10] << 22) | ((payload[11] & 0xFE) << 14) |
+                        (payload[12] << 7) | (payload[13] >> 1);
+          if (!is_random_access &&
+              !IsKeyframe(codec, payload + header_size, size - header_size)) {
+            continue;
+          }
+          // PTS are 33 bits wide & wrap around every ~26.5 hours.
+          if (last_pts >= 0 && pts + (1ll << 32) < last_pts) wraps++;
+          last_pts = pts;
+          pts += wraps << 33;
+          if (first_pts < 0) first_pts = pts;
+          int64_t time = (pts - first_pts) * 100 / 9;
+          if (keyframes.empty() || time > keyframes.back().time) {
+            keyframes.push_back({time});
+          }
+        }
+      }
+    }
+    return keyframes;
+  }
+
+  // Returns the PID of the first program's PMT, or -1.
+  static int32_t ParsePat(const uint8_t* payload, size_t size) {
+    size_t section = 1 + payload[0];
+    if (section + 8 > size || payload[section] != 0x00) return -1;
+    size_t length = ((payload[section + 1] & 0x0F) << 8) | payload[section + 2];
+    size_t end = std::min(size, section + 3 + length) - 4;
+    for (size_t i = section + 8; i + 4 <= end; i += 4) {
+      int32_t program = (payload[i] << 8) | payload[i + 1];
+      // Program 0 points to the network information table.
+      if (program != 0) return ((payload[i + 2] & 0x1F) << 8) | payload[i + 3];
+    }
+    return -1;
+  }
+
+  // Returns the PID of the first video stream & stores its |codec|, or -1.
+  static int32_t ParsePmt(const uint8_t* payload, size_t size, Codec& codec) {
+    size_t section = 1 + payload[0];
+    if (section + 12 > size || payload[section] != 0x02) return -1;
+    size_t length = ((payload[section + 1] & 0x0F) << 8) | payload[section + 2];
+    size_t end = std::min(size, section + 3 + length) - 4;
+    size_t info_length =
+        ((payload[section + 10] & 0x0F) << 8) | payload[section + 11];
+    for (size_t i = section + 12 + info_length; i + 5 <= end;) {
+      uint8_t type = payload[i];
+      int32_t pid = ((payload[i + 1] & 0x1F) << 8) | payload[i + 2];
+      switch (type) {
+        case 0x01:
+        case 0x02:
+          codec = mpeg2;
+          return pid;
+        case 0x10:
+          codec = mpeg4;
+          return pid;
+        case 0x1B:
+          codec = h264;
+          return pid;
+        case 0x24:
+          codec = hevc;
+          return pid;
+      }
+      i += 5 + (((payload[i + 3] & 0x0F) << 8) | payload[i + 4]);
+    }
+    return -1;
+  }
+
+  struct AviStream {
+    int32_t number = -1;
+    Codec codec = unknown;
+    // Frame duration is |scale| / |rate| seconds.
+    uint32_t scale = 0;
+    uint32_t rate = 0;
+  };
+
+  static uint32_t ReadUint32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+  }
+
+  static Codec AviCodec(const uint8_t* fourcc) {
+    std::string name(reinterpret_cast<const char*>(fourcc), 4);
+    for (char& c : name) c = static_cast<char>(toupper(c));
+    if (name == "H264" || name == "X264" || name == "AVC1") return h264;
+    if (name == "HEVC" || name == "H265" || name == "HVC1") return hevc;
+    if (name == "MJPG") return mjpeg;
+    if (name == "MPG1" || name == "MPG2" || name == "MPEG") return mpeg2;
+    if (name == "XVID" || name == "DIVX" || name == "DX50" || name == "FMP4" ||
+        name == "MP4V") {
+      return mpeg4;
+    }
+    return unknown;
+  }
+
+  // Uses the idx1 index when present, which flags keyframes, & otherwise
+  // walks the chunks of the movi list.
+  static std::optional<std::vector<Keyframe>> ScanAvi(std::ifstream& file) {
+    AviStream stream;
+    int64_t movi_start = -1, movi_end = -1, idx1_start = -1, idx1_size = 0;
+    int64_t position = 12;
+    uint8_t header[12];
+    while (file.seekg(position) &&
+           file.read(reinterpret_cast<char*>(header), 12)) {
+      int64_t size = ReadUint32(header + 4);
+      if (memcmp(header, "LIST", 4) == 0 &&
+          memcmp(header + 8, "hdrl", 4) == 0 && size >= 4 &&
+          size <= kBufferSize) {
+        std::vector<uint8_t> hdrl(static_cast<size_t>(size - 4));
+        file.read(reinterpret_cast<char*>(hdrl.data()), hdrl.size());
+        if (file) stream = ParseHdrl(hdrl);
+      } else if (memcmp(header, "LIST", 4) == 0 &&
+                 memcmp(header + 8, "movi", 4) == 0) {
+        movi_start = position + 8;
+        movi_end = position + 8 + size;
+      } else if (memcmp(header, "idx1", 4) == 0) {
+        idx1_start = position + 8;
+        idx1_size = size;
+      }
+      position += 8 + size + (size & 1);
+    }
+    file.clear();
+    if (stream.number < 0 || !stream.rate || movi_start < 0) {
+      return std::nullopt;
+    }
+    char data_id[4] = {static_cast<char>('0' + stream.number / 10),
+                       static_cast<char>('0' + stream.number % 10), 'd', 'c'};
+    char raw_id[4] = {data_id[0], data_id[1], 'd', 'b'};
+    auto time = [&](int64_t frame) -> int64_t {
+      return frame * stream.scale * 1000000 / stream.rate;
+    };
+    std::vector<Keyframe> keyframes;
+    int64_t frame = 0;
+    if (idx1_start >= 0) {
+      std::vector<uint8_t> index(static_cast<size_t>(idx1_size));
+      file.seekg(idx1_start);
+      file.read(reinterpret_cast<char*>(index.data()), index.size());
+      size_t count = static_cast<size_t>(file.gcount()) / 16;
+      for (size_t i = 0; i < count; i++) {
+        const uint8_t* entry = index.data() + i * 16;
+        if (memcmp(entry, data_id, 4) != 0 && memcmp(entry, raw_id, 4) != 0) {
+          continue;
+        }
+        // AVIIF_KEYFRAME.
+        if (ReadUint32(entry + 4) & 0x10) keyframes.push_back({time(frame)});
+        frame++;
+      }
+      if (!keyframes.empty()) return keyframes;
+      frame = 0;
+    }
+    if (stream.codec == unknown) return std::nullopt;
+    std::vector<uint8_t> data(64);
+    position = movi_start + 4;
+    while (position + 8 <= movi_end && file.seekg(position) &&
+           file.read(reinterpret_cast<char*>(header), 8)) {
+      int64_t size = ReadUint32(header + 4);
+      // Enter "rec " lists.
+      if (memcmp(header, "LIST", 4) == 0) {
+        position += 12;
+        continue;
+      }
+      if (memcmp(header, data_id, 4) == 0 || memcmp(header, raw_id, 4) == 0) {
+        file.read(reinterpret_cast<char*>(data.data()),
+                  std::min<int64_t>(size, data.size()));
+        if (IsKeyframe(stream.codec, data.data(),
+                       static_cast<size_t>(file.gcount()))) {
+          keyframes.push_back({time(frame)});
+        }
+        frame++;
+      }
+      position += 8 + size + (size & 1);
+    }
+    return keyframes;
+  }
+
+  // Returns the first video stream declared in the hdrl list.
+  static AviStream ParseHdrl(const std::vector<uint8_t>& hdrl) {
+    AviStream stream;
+    int32_t number = 0;
+    for (size_t i = 0; i + 8 <= hdrl.size();) {
+      size_t size = ReadUint32(hdrl.data() + i + 4);
+      const uint8_t* data = hdrl.data() + i + 8;
+      if (memcmp(hdrl.data() + i, "LIST", 4) == 0) {
+        // Descend into strl lists.
+        i += 12;
+        continue;
+      }
+      if (i + 8 + size > hdrl.size()) break;
+      if (memcmp(hdrl.data() + i, "strh", 4) == 0 && size >= 28) {
+        if (stream.number < 0 && memcmp(data, "vids", 4) == 0) {
+          stream.number = number;
+          stream.codec = AviCodec(data + 4);
+          stream.scale = ReadUint32(data + 20);
+          stream.rate = ReadUint32(data + 24);
+        }
+        number++;
+      } else if (memcmp(hdrl.data() + i, "strf", 4) == 0 && size >= 20 &&
+                 stream.number == number - 1 && stream.codec == unknown) {
+        // biCompression of the BITMAPINFOHEADER.
+        stream.codec = AviCodec(data + 16);
+      }
+      i += 8 + size + (size & 1);
+    }
+    return stream;
+  }
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_LOOPWATCHER_H_
+#define INTERNAL_LOOPWATCHER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Watches the playback clock from its own thread & wraps around once the end
+// of a region is reached. libVLC only updates its time when frames or audio
+// blocks are output, so the clock is extrapolated from its last change & the
+// wraparound is armed to fire at the predicted end rather than on the next
+// poll.
+class LoopWatcher {
+ public:
+  static constexpr auto kInterval = std::chrono::milliseconds(10);
+
+  struct Sample {
+    // Microseconds.
+    int64_t time;
+    // 0 while not playing.
+    float rate;
+  };
+
+  ~LoopWatcher() { Stop(); }
+
+  // Loops [|start|, |end|) microseconds |count| times, 0 for ever. |clock| is
+  // polled every |kInterval|, |wrap| is called with the 1-based iteration
+  // once the end is reached & must seek back to |start|. Both are called from
+  // the watcher's thread. A running loop is stopped first.
+  void Start(int64_t start, int64_t end, int32_t count,
+             std::function<Sample()> clock,
+             std::function<void(int32_t)> wrap) {
+    Stop();
+    is_stopped_ = false;
+    thread_ = std::thread([=]() -> void {
+      int32_t iteration = 0;
+      int64_t reported = -1;
+      auto reported_at = std::chrono::steady_clock::now();
+      // Whether the clock is inside the region, a seek past |end| must not
+      // trigger a wraparound.
+      bool is_armed = false;
+      // Whether the seek back is in progress, during which the clock still
+      // reports times close to |end|.
+      bool is_wrapping = false;
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!is_stopped_) {
+        Sample sample = clock();
+        auto now = std::chrono::steady_clock::now();
+        if (sample.time != reported) {
+          reported = sample.time;
+          reported_at = now;
+        }
+        int64_t elapsed = std::min<int64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                now - reported_at)
+                .count(),
+            kMaximumExtrapolation);
+        int64_t time = reported + static_cast<int64_t>(elapsed * sample.rate);
+        int64_t step = std::chrono::duration_cast<std::chrono::microseconds>(
+                           kInterval)
+                           .count();
+        // A late poll may slightly overshoot |end|, anything further is a
+        // seek out of the region.
+        if (time < start || time >= end + 2 * step) {
+          is_armed = false;
+        } else if (!is_armed) {
+          is_armed = time < end &&
+                     (!is_wrapping || time < start + (end - start) / 2);
+          if (is_armed) is_wrapping = false;
+        }
+        if (is_armed && sample.rate > 0 &&
+            time + static_cast<int64_t>(step * sample.rate) >= end) {
+          auto remaining = std::chrono::microseconds(static_cast<int64_t>(
+              std::max<int64_t>(end - time, 0) / sample.rate));
+          if (condition_.wait_for(lock, remaining,
+                                  [this]() { return is_stopped_; })) {
+            return;
+          }
+          is_armed = false;
+          is_wrapping = true;
+          reported = -1;
+          iteration++;
+          lock.unlock();
+          wrap(iteration);
+          lock.lock();
+          if (count > 0 && iteration >= count) return;
+          continue;
+        }
+        condition_.wait_for(lock, kInterval, [this]() { return is_stopped_; });
+      }
+    });
+  }
+
+  // Stops the running loop. Must not be called from |clock| or |wrap|.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = true;
+    }
+    condition_.notify_all();
+    if (thread_.joinable()) thread_.join();
+  }
+
+ private:
+  // Microseconds past its last change the clock is extrapolated for, e.g.
+  // while buffering.
+  static constexpr int64_t kMaximumExtrapolation = 500000;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool is_stopped_ = true;
+};
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_LOUDNESSMETER_H_
+#define INTERNAL_LOUDNESSMETER_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+// Measures the loudness of stereo 48 kHz audio following EBU R128 (ITU-R
+// BS.1770-4 & EBU Tech 3341/3342): gated integrated loudness, loudness range
+// & true peak.
+class LoudnessMeter {
+ public:
+  static constexpr int32_t kRate = 48000;
+  static constexpr int32_t kChannels = 2;
+  // Reported for silent medias, below the absolute gate.
+  static constexpr double kSilence = -70.0;
+
+  LoudnessMeter() {
+    // Polyphase windowed sinc interpolator, the true peak is the highest
+    // absolute sample after 4x oversampling.
+    for (int32_t phase = 0; phase < kOversampling; phase++) {
+      for (int32_t tap = 0; tap < kTaps; tap++) {
+        double position = tap - kTaps / 2 + 1 -
+                          static_cast<double>(phase) / kOversampling;
+        double sinc = position == 0.0
+                          ? 1.0
+                          : std::sin(kPi * position) / (kPi * position);
+        double window =
+            0.5 + 0.5 * std::cos(kPi * position / (kTaps / 2.0 + 1.0));
+        interpolator_[phase][tap] = static_cast<float>(sinc * window);
+      }
+    }
+  }
+
+  // Feeds |frames| interleaved frames.
+  void Add(const float* samples, size_t frames) {
+    for (size_t frame = 0; frame < frames; frame++) {
+      for (int32_t channel = 0; channel < kChannels; channel++) {
+        float sample = samples[frame * kChannels + channel];
+        double weighted = Filter(channel, sample);
+        segment_power_[channel] += weighted * weighted;
+        MeasurePeak(channel, sample);
+      }
+      if (++segment_frames_ == kSegmentFrames) CloseSegment();
+    }
+    frames_ += frames;
+  }
+
+  // Gated loudness of the whole input in LUFS.
+  double IntegratedLoudness() const {
+    return GatedLoudness(block_powers_, kRelativeGate);
+  }
+
+  // Sum of the powers of the blocks above the gates & their count, used to
+  // combine the integrated loudness of several medias, e.g. of an album.
+  std::pair<double, uint64_t> GatedPower() const {
+    double threshold = RelativeThreshold(block_powers_, kRelativeGate);
+    double sum = 0.0;
+    uint64_t count = 0;
+    for (double power : block_powers_) {
+      if (power > threshold) {
+        sum += power;
+        count++;
+      }
+    }
+    return {sum, count};
+  }
+
+  // Difference in LU between the 10th & 95th percentiles of the gated short
+  // term loudness.
+  double LoudnessRange() const {
+    double threshold = RelativeThreshold(short_term_powers_, kRangeGate);
+    std::vector<double> loudnesses;
+    for (double power : short_term_powers_) {
+      if (power > threshold) loudnesses.emplace_back(Loudness(power));
+    }
+    if (loudnesses.empty()) return 0.0;
+    std::sort(loudnesses.begin(), loudnesses.end());
+    auto percentile = [&](double ratio) -> double {
+      return loudnesses[static_cast<size_t>(ratio * (loudnesses.size() - 1) +
+                                            0.5)];
+    };
+    return percentile(0.95) - percentile(0.1);
+  }
+
+  // Highest inter-sample peak in dBTP.
+  double TruePeak() const {
+    return peak_ > 0.0f ? 20.0 * std::log10(peak_) : kSilence;
+  }
+
+  // Seconds of audio fed.
+  double Duration() const { return static_cast<double>(frames_) / kRate; }
+
+  static double Loudness(double power) {
+    return power > 0.0 ? -0.691 + 10.0 * std::log10(power) : kSilence;
+  }
+
+ private:
+  static constexpr double kPi = 3.14159265358979323846;
+  // Blocks are made of 100 ms segments: 400 ms momentary blocks overlapping
+  // by 75% & 3 s short term blocks for the loudness range.
+  static constexpr int32_t kSegmentFrames = kRate / 10;
+  static constexpr size_t kBlockSegments = 4;
+  static constexpr size_t kShortTermSegments = 30;
+  static constexpr double kAbsoluteGate = -70.0;
+  static constexpr double kRelativeGate = -10.0;
+  static constexpr double kRangeGate = -20.0;
+  static constexpr int32_t kOversampling = 4;
+  static constexpr int32_t kTaps = 12;
+
+  // K-weighting: high shelf followed by the RLB high pass, coefficients for
+  // 48 kHz from BS.1770.
+  struct Biquad {
+    double b0, b1, b2, a1, a2;
+  };
+  static constexpr Biquad kShelf = {1.53512485958697, -2.69169618940638,
+                                    1.19839281085285, -1.69065929318241,
+                                    0.73248077421585};
+  static constexpr Biquad kHighPass = {1.0, -2.0, 1.0, -1.99004745483398,
+                                       0.99007225036621};
+
+  double Filter(int32_t channel, double sample) {
+    std::array<double, 4>& state = filter_state_[channel];
+    double shelf = kShelf.b0 * sample + state[0];
+    state[0] = kShelf.b1 * sample - kShelf.a1 * shelf + state[1];
+    state[1] = kShelf.b2 * sample - kShelf.a2 * shelf;
+    double weighted = kHighPass.b0 * shelf + state[2];
+    state[2] = kHighPass.b1 * shelf - kHighPass.a1 * weighted + state[3];
+    state[3] = kHighPass.b2 * shelf - kHighPass.a2 * weighted;
+    return weighted;
+  }
+
+  void MeasurePeak(int32_t channel, float sample) {
+    std::array<float, kTaps>& history = peak_history_[channel];
+    std::copy(history.begin() + 1, history.end(), history.begin());
+    history.back() = sample;
+    for (int32_t phase = 0; phase < kOversampling; phase++) {
+      float value = 0.0f;
+      for (int32_t tap = 0; tap < kTaps; tap++) {
+        value += history[tap] * interpolator_[phase][tap];
+      }
+      peak_ = std::max(peak_, std::abs(value));
+    }
+    peak_ = std::max(peak_, std::abs(sample));
+  }
+
+  void CloseSegment() {
+    // Mean square of the segment, summed over channels weighted 1 for left
+    // & right.
+    double power = 0.0;
+    for (int32_t channel = 0; channel < kChannels; channel++) {
+      power += segment_power_[channel] / kSegmentFrames;
+      segment_power_[channel] = 0.0;
+    }
+    segment_frames_ = 0;
+    segments_.emplace_back(power);
+    if (segments_.size() > kShortTermSegments) segments_.pop_front();
+    if (segments_.size() >= kBlockSegments) {
+      block_powers_.emplace_back(Mean(segments_.end() - kBlockSegments,
+                                      segments_.end()));
+    }
+    if (segments_.size() == kShortTermSegments) {
+      short_term_powers_.emplace_back(
+          Mean(segments_.begin(), segments_.end()));
+    }
+  }
+
+  template <typename Iterator>
+  static double Mean(Iterator first, Iterator last) {
+    double sum = 0.0;
+    size_t count = 0;
+    for (; first != last; ++first, ++count) sum += *first;
+    return count ? sum / count : 0.0;
+  }
+
+  // Power below which blocks are discarded: the absolute gate, then |gate|
+  // LU below the mean of the blocks above the absolute gate.
+  static double RelativeThreshold(const std::vector<double>& powers,
+                                  double gate) {
+    double absolute = std::pow(10.0, (kAbsoluteGate + 0.691) / 10.0);
+    double sum = 0.0;
+    size_t count = 0;
+    for (double power : powers) {
+      if (power > absolute) {
+        sum += power;
+        count++;
+      }
+    }
+    if (count == 0) return std::numeric_limits<double>::infinity();
+    return std::max(absolute, sum / count * std::pow(10.0, gate / 10.0));
+  }
+
+  static double GatedLoudness(const std::vector<double>& powers,
+                              double gate) {
+    double threshold = RelativeThreshold(powers, gate);
+    double sum = 0.0;
+    size_t count = 0;
+    for (double power : powers) {
+      if (power > threshold) {
+        sum += power;
+        count++;
+      }
+    }
+    return count ? Loudness(sum / count) : kSilence;
+  }
+
+  std::array<std::array<double, 4>, kChannels> filter_state_{};
+  std::array<double, kChannels> segment_power_{};
+  int32_t segment_frames_ = 0;
+  std::deque<double> segments_;
+  std::vector<double> block_powers_;
+  std::vector<double> short_term_powers_;
+  std::array<std::array<float, kTaps>, kOversampling> interpolator_;
+  std::array<std::array<float, kTaps>, kChannels> peak_history_{};
+  float peak_ = 0.0f;
+  uint64_t frames_ = 0;
+};
+
+#endif
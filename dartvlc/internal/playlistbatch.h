@@ -0,0 +1,76 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_PLAYLISTBATCH_H_
+#define INTERNAL_PLAYLISTBATCH_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// A list of playlist mutations, applied at once by |PlayerSetters::Apply|
+// with a single playlist update & event. Operations are applied in order,
+// each one seeing the indices produced by the previous ones.
+class PlaylistBatch {
+ public:
+  // Media type & resource of an entry, e.g. {"MediaType.file", "/a.mp3"}.
+  typedef std::pair<std::string, std::string> Item;
+
+  enum Type : int32_t { add, remove, move, replace };
+
+  struct Operation {
+    Type type;
+    // |add|: insertion index, -1 to append. |remove|: first removed entry.
+    // |move|: entry being moved.
+    int32_t index;
+    // |remove|: number of removed entries. |move|: destination index.
+    int32_t count;
+    // |add| & |replace|: range of |items_|.
+    size_t first_item;
+    size_t item_count;
+  };
+
+  const std::vector<Operation>& operations() const { return operations_; }
+  const std::vector<Item>& items() const { return items_; }
+  bool empty() const { return operations_.empty(); }
+
+  // Inserts |items| before |index|, or appends them if |index| is -1.
+  void Add(int32_t index, std::vector<Item> items) {
+    operations_.push_back({add, index, 0, items_.size(), items.size()});
+    Append(std::move(items));
+  }
+
+  void Remove(int32_t index, int32_t count = 1) {
+    operations_.push_back({remove, index, count, 0, 0});
+  }
+
+  void Move(int32_t initial, int32_t final) {
+    operations_.push_back({move, initial, final, 0, 0});
+  }
+
+  // Replaces every entry with |items|. The current entry keeps playing if it
+  // is still present, so that e.g. shuffling a queue is not audible.
+  void Replace(std::vector<Item> items) {
+    operations_.push_back({replace, 0, 0, items_.size(), items.size()});
+    Append(std::move(items));
+  }
+
+ private:
+  void Append(std::vector<Item> items) {
+    items_.insert(items_.end(), std::make_move_iterator(items.begin()),
+                  std::make_move_iterator(items.end()));
+  }
+
+  std::vector<Operation> operations_;
+  std::vector<Item> items_;
+};
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_PLAYLISTENTRIES_H_
+#define INTERNAL_PLAYLISTENTRIES_H_
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "mediasource/media.h"
+
+// Compact storage for the medias of a player's playlist. Each entry only keeps
+// its media type & a pointer to its resource, which is interned inside an
+// append-only arena, so that queues of tens of thousands of items stay cheap
+// to build & identical resources are stored once. |Media| objects are only
+// created on demand.
+class PlaylistEntries {
+ public:
+  static constexpr const char* kMediaTypes[] = {
+      Media::kMediaTypeFile, Media::kMediaTypeNetwork,
+      Media::kMediaTypeDirectShow};
+
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+  const char* media_type(size_t index) const {
+    return kMediaTypes[entries_[index].media_type];
+  }
+
+  const char* resource(size_t index) const { return entries_[index].resource; }
+
+  std::shared_ptr<Media> media(size_t index) const {
+    return Media::create(media_type(index), resource(index));
+  }
+
+  void Add(const std::string& media_type, const std::string& resource) {
+    entries_.push_back(CreateEntry(media_type, resource));
+  }
+
+  void Add(const std::shared_ptr<Media>& media) {
+    Add(media->media_type(), media->resource());
+  }
+
+  void Insert(size_t index, const std::shared_ptr<Media>& media) {
+    entries_.insert(entries_.begin() + index,
+                    CreateEntry(media->media_type(), media->resource()));
+  }
+
+  // Inserts the {media type, resource} pairs of [first, last) before |index|
+  // with a single reallocation.
+  template <typename Iterator>
+  void Insert(size_t index, Iterator first, Iterator last) {
+    std::vector<Entry> entries;
+    entries.reserve(std::distance(first, last));
+    for (; first != last; ++first) {
+      entries.push_back(CreateEntry(first->first, first->second));
+    }
+    entries_.insert(entries_.begin() + index, entries.begin(), entries.end());
+  }
+
+  void Remove(size_t index, size_t count = 1) {
+    entries_.erase(entries_.begin() + index, entries_.begin() + index + count);
+  }
+
+  void Move(size_t initial, size_t final) {
+    if (initial < final) {
+      std::rotate(entries_.begin() + initial, entries_.begin() + initial + 1,
+                  entries_.begin() + final + 1);
+    } else if (initial > final) {
+      std::rotate(entries_.begin() + final, entries_.begin() + initial,
+                  entries_.begin() + initial + 1);
+    }
+  }
+
+  // Returns the index of the first entry matching |media_type| & |resource|,
+  // or -1.
+  int32_t IndexOf(std::string_view media_type,
+                  std::string_view resource) const {
+    auto it = strings_.find(resource);
+    if (it == strings_.end()) return -1;
+    for (size_t i = 0; i < entries_.size(); i++) {
+      // Resources are interned, comparing pointers is enough.
+      if (entries_[i].resource == it->data() &&
+          media_type == this->media_type(i)) {
+        return static_cast<int32_t>(i);
+      }
+    }
+    return -1;
+  }
+
+  void Clear() {
+    entries_.clear();
+    strings_.clear();
+    chunks_.clear();
+    chunk_offset_ = kChunkSize;
+  }
+
+ private:
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  struct Entry {
+    const char* resource;
+    uint8_t media_type;
+  };
+
+  Entry CreateEntry(std::string_view media_type, std::string_view resource) {
+    uint8_t type = 0;
+    while (type < std::size(kMediaTypes) - 1 &&
+           media_type != kMediaTypes[type]) {
+      type++;
+    }
+    return Entry{Intern(resource), type};
+  }
+
+  // Returns a null-terminated copy of |value| which lives as long as the
+  // arena. Chunks are never reallocated, so returned pointers stay valid.
+  const char* Intern(std::string_view value) {
+    auto it = strings_.find(value);
+    if (it != strings_.end()) return it->data();
+    size_t size = value.size() + 1;
+    if (chunk_offset_ + size > kChunkSize) {
+      chunks_.emplace_back(new char[std::max(size, kChunkSize)]);
+      chunk_offset_ = 0;
+    }
+    char* string = chunks_.back().get() + chunk_offset_;
+    memcpy(string, value.data(), value.size());
+    string[value.size()] = '\0';
+    // Oversized strings get a chunk of their own.
+    chunk_offset_ = size > kChunkSize ? kChunkSize : chunk_offset_ + size;
+    strings_.emplace(string, value.size());
+    return string;
+  }
+
+  std::vector<Entry> entries_;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  size_t chunk_offset_ = kChunkSize;
+  std::unordered_set<std::string_view> strings_;
+};
+
+#endif
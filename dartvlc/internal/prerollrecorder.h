@@ -0,0 +1,271 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_PREROLLRECORDER_H_
+#define INTERNAL_PREROLLRECORDER_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "internal/udpsocket.h"
+
+// Keeps the last seconds of an MPEG-TS stream received over loopback UDP
+// in memory, split in groups starting on keyframes, & writes clips made of
+// this pre-roll followed by the stream received after a trigger. Nothing is
+// transcoded. Clips are written by a thread of their own, so that disk I/O
+// never delays receiving.
+class PrerollRecorder {
+ public:
+  // Called with the path of a clip once it is complete, from the writing
+  // thread.
+  typedef std::function<void(const std::string& path)> ClipCallback;
+
+  // Clips are written to |directory|, keeping |preroll| seconds before each
+  // trigger, bounded to |max_bytes| of memory, 0 for no limit.
+  PrerollRecorder(std::filesystem::path directory, int32_t preroll,
+                  int64_t max_bytes, ClipCallback callback)
+      : directory_(directory),
+        preroll_(std::chrono::seconds(preroll)),
+        max_bytes_(max_bytes),
+        callback_(callback) {
+    thread_ = std::thread(&PrerollRecorder::Run, this);
+    writer_ = std::thread(&PrerollRecorder::WriteClips, this);
+  }
+
+  // The clip being recorded is cut short & completed.
+  ~PrerollRecorder() {
+    is_stopped_ = true;
+    if (thread_.joinable()) thread_.join();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      EndClip();
+    }
+    condition_.notify_one();
+    if (writer_.joinable()) writer_.join();
+  }
+
+  // Port to send the stream to, 0 if none could be bound.
+  uint16_t port() const { return socket_.port(); }
+
+  // Queues the pre-roll as the start of a new clip & keeps recording the
+  // stream for |post| seconds. Triggering during a clip extends it instead.
+  void Trigger(int32_t post) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Clock::time_point deadline = Clock::now() + std::chrono::seconds(post);
+      if (is_recording_) {
+        deadline_ = std::max(deadline_, deadline);
+        return;
+      }
+      auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+      Chunk chunk;
+      chunk.path = directory_ / ("clip-" + std::to_string(now) + ".ts");
+      chunk.data.reserve(static_cast<size_t>(bytes_) + 2 * kPacketSize);
+      chunks_.emplace_back(std::move(chunk));
+      is_recording_ = true;
+      deadline_ = deadline;
+      // Decoders need the tables before the first keyframe, they may not be
+      // repeated in the pre-roll.
+      if (pat_) Queue(pat_->data(), kPacketSize);
+      if (pmt_) Queue(pmt_->data(), kPacketSize);
+      for (const Group& group : groups_) {
+        Queue(group.data.data(), group.data.size());
+      }
+    }
+    condition_.notify_one();
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+  typedef std::array<uint8_t, 188> Packet;
+
+  static constexpr size_t kPacketSize = 188;
+  static constexpr uint8_t kSyncByte = 0x47;
+  // Streams without random access indicators, e.g. audio only, are split
+  // on payload starts at this interval instead.
+  static constexpr auto kFallbackInterval = std::chrono::seconds(1);
+
+  // Packets from a keyframe up to the next one.
+  struct Group {
+    Clock::time_point start;
+    std::vector<uint8_t> data;
+  };
+
+  // Data queued for |writer_|, in order.
+  struct Chunk {
+    // Starts a new clip, if not empty.
+    std::filesystem::path path;
+    std::vector<uint8_t> data;
+    // Completes the clip once |data| is written.
+    bool is_last = false;
+  };
+
+  void Run() {
+    std::vector<uint8_t> datagram(65536);
+    while (!is_stopped_) {
+      size_t size = socket_.Receive(datagram.data(),
+                                    static_cast<int32_t>(datagram.size()),
+                                    std::chrono::milliseconds(100));
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t offset = 0; offset + kPacketSize <= size;
+             offset += kPacketSize) {
+          if (datagram[offset] == kSyncByte) Push(&datagram[offset]);
+        }
+        if (is_recording_ && Clock::now() >= deadline_) EndClip();
+      }
+      condition_.notify_one();
+    }
+  }
+
+  void Push(const uint8_t* packet) {
+    Clock::time_point now = Clock::now();
+    int32_t pid = ((packet[1] & 0x1F) << 8) | packet[2];
+    bool is_payload_start = packet[1] & 0x40;
+    bool has_adaptation = packet[3] & 0x20;
+    bool is_random_access =
+        has_adaptation && packet[4] > 0 && (packet[5] & 0x40);
+    if (pid == 0 && is_payload_start) ParsePat(packet);
+    if (pid == pmt_pid_ && is_payload_start) {
+      pmt_ = Packet();
+      std::memcpy(pmt_->data(), packet, kPacketSize);
+    }
+    has_random_access_ = has_random_access_ || is_random_access;
+    bool starts_group =
+        groups_.empty() || is_random_access ||
+        (!has_random_access_ && is_payload_start && pid != 0 &&
+         pid != pmt_pid_ && now - groups_.back().start >= kFallbackInterval);
+    if (starts_group) groups_.push_back(Group{now, {}});
+    groups_.back().data.insert(groups_.back().data.end(), packet,
+                               packet + kPacketSize);
+    bytes_ += kPacketSize;
+    // The oldest group is dropped once the next one starts early enough to
+    // cover the pre-roll alone.
+    while (groups_.size() > 1 &&
+           (groups_[1].start <= now - preroll_ ||
+            (max_bytes_ > 0 && bytes_ > max_bytes_))) {
+      bytes_ -= groups_.front().data.size();
+      groups_.pop_front();
+    }
+    if (is_recording_) Queue(packet, kPacketSize);
+  }
+
+  // Stores the PAT & the PID of the PMT of its first program. Tables are
+  // assumed to fit a single packet, as muxed by VLC.
+  void ParsePat(const uint8_t* packet) {
+    size_t offset = 4;
+    if (packet[3] & 0x20) offset += 1 + packet[4];
+    if (offset >= kPacketSize) return;
+    offset += 1 + packet[offset];
+    if (offset + 8 > kPacketSize || packet[offset] != 0x00) return;
+    size_t length = ((packet[offset + 1] & 0x0F) << 8) | packet[offset + 2];
+    size_t end = std::min(offset + 3 + length - 4, kPacketSize);
+    for (size_t program = offset + 8; program + 4 <= end; program += 4) {
+      int32_t number = (packet[program] << 8) | packet[program + 1];
+      if (number == 0) continue;
+      pmt_pid_ = ((packet[program + 2] & 0x1F) << 8) | packet[program + 3];
+      pat_ = Packet();
+      std::memcpy(pat_->data(), packet, kPacketSize);
+      return;
+    }
+  }
+
+  // Appends to the clip being recorded. Requires |mutex_|.
+  void Queue(const uint8_t* data, size_t size) {
+    if (chunks_.empty() || chunks_.back().is_last) chunks_.emplace_back();
+    std::vector<uint8_t>& queued = chunks_.back().data;
+    queued.insert(queued.end(), data, data + size);
+  }
+
+  // Completes the clip being recorded. Requires |mutex_|.
+  void EndClip() {
+    if (!is_recording_) return;
+    is_recording_ = false;
+    if (chunks_.empty() || chunks_.back().is_last) chunks_.emplace_back();
+    chunks_.back().is_last = true;
+  }
+
+  // Runs on |writer_| until stopped & every queued chunk is written.
+  void WriteClips() {
+    while (true) {
+      Chunk chunk;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this]() -> bool {
+          return is_stopped_ || !chunks_.empty();
+        });
+        if (chunks_.empty()) break;
+        chunk = std::move(chunks_.front());
+        chunks_.pop_front();
+      }
+      if (!chunk.path.empty()) {
+        CloseClip();
+        std::error_code code;
+        std::filesystem::create_directories(directory_, code);
+        clip_path_ = chunk.path;
+        clip_.open(clip_path_, std::ios::binary | std::ios::trunc);
+      }
+      if (clip_.is_open()) {
+        clip_.write(reinterpret_cast<const char*>(chunk.data.data()),
+                    chunk.data.size());
+      }
+      if (chunk.is_last) CloseClip();
+    }
+    CloseClip();
+  }
+
+  void CloseClip() {
+    if (!clip_.is_open()) return;
+    clip_.close();
+    if (callback_) callback_(clip_path_.u8string());
+  }
+
+  std::filesystem::path directory_;
+  Clock::duration preroll_;
+  int64_t max_bytes_;
+  ClipCallback callback_;
+  UdpSocket socket_;
+  std::mutex mutex_;
+  std::deque<Group> groups_;
+  int64_t bytes_ = 0;
+  bool has_random_access_ = false;
+  int32_t pmt_pid_ = -1;
+  std::optional<Packet> pat_;
+  std::optional<Packet> pmt_;
+  bool is_recording_ = false;
+  Clock::time_point deadline_;
+  std::deque<Chunk> chunks_;
+  std::condition_variable condition_;
+  // Used by |writer_| only.
+  std::ofstream clip_;
+  std::filesystem::path clip_path_;
+  std::atomic<bool> is_stopped_ = false;
+  std::thread thread_;
+  std::thread writer_;
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_RINGBUFFER_H_
+#define INTERNAL_RINGBUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+// Lock-free ring buffer for a single producer & a single consumer thread.
+//
+// Both positions only ever grow, the element at position |p| is stored at
+// |data()[p % capacity()]|. The producer writes the elements before
+// publishing |write_position()| & the consumer reads them before publishing
+// |read_position()|, so that a reader outside C++, e.g. Dart through FFI, may
+// consume the ring directly from these addresses.
+template <typename T>
+class RingBuffer {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+ public:
+  // |capacity| is rounded up to a power of two.
+  explicit RingBuffer(size_t capacity) {
+    capacity_ = 1;
+    while (capacity_ < capacity) capacity_ <<= 1;
+    data_.reset(new T[capacity_]);
+  }
+
+  size_t capacity() const { return capacity_; }
+
+  T* data() { return data_.get(); }
+
+  std::atomic<uint64_t>* write_position() { return &write_position_; }
+
+  std::atomic<uint64_t>* read_position() { return &read_position_; }
+
+  // Elements available to the consumer.
+  size_t Available() const {
+    return static_cast<size_t>(
+        write_position_.load(std::memory_order_acquire) -
+        read_position_.load(std::memory_order_acquire));
+  }
+
+  // Room left for the producer.
+  size_t Space() const { return capacity_ - Available(); }
+
+  // Producer. Writes up to |count| elements & returns how many were written,
+  // elements which do not fit are dropped.
+  size_t Write(const T* elements, size_t count) {
+    uint64_t write = write_position_.load(std::memory_order_relaxed);
+    uint64_t read = read_position_.load(std::memory_order_acquire);
+    count = std::min(count, capacity_ - static_cast<size_t>(write - read));
+    Copy(data_.get(), Index(write), elements, count);
+    write_position_.store(write + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer. Reads up to |count| elements & returns how many were read.
+  size_t Read(T* elements, size_t count) {
+    uint64_t read = read_position_.load(std::memory_order_relaxed);
+    uint64_t write = write_position_.load(std::memory_order_acquire);
+    count = std::min(count, static_cast<size_t>(write - read));
+    size_t index = Index(read);
+    size_t first = std::min(count, capacity_ - index);
+    std::memcpy(elements, data_.get() + index, first * sizeof(T));
+    std::memcpy(elements + first, data_.get(), (count - first) * sizeof(T));
+    read_position_.store(read + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer. Drops everything written so far.
+  void Clear() {
+    read_position_.store(write_position_.load(std::memory_order_acquire),
+                         std::memory_order_release);
+  }
+
+ private:
+  size_t Index(uint64_t position) const {
+    return static_cast<size_t>(position & (capacity_ - 1));
+  }
+
+  void Copy(T* destination, size_t index, const T* elements, size_t count) {
+    size_t first = std::min(count, capacity_ - index);
+    std::memcpy(destination + index, elements, first * sizeof(T));
+    std::memcpy(destination, elements + first, (count - first) * sizeof(T));
+  }
+
+  size_t capacity_;
+  std::unique_ptr<T[]> data_;
+  // On separate cache lines, each is written by a different thread.
+  alignas(64) std::atomic<uint64_t> write_position_ = 0;
+  alignas(64) std::atomic<uint64_t> read_position_ = 0;
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_SEEKSCHEDULER_H_
+#define INTERNAL_SEEKSCHEDULER_H_
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+// |fast| seeks land on the closest keyframe, |precise| ones on the exact
+// requested time.
+enum SeekMode : int32_t { precise, fast };
+
+// Coalesces seeks so that only one is in flight at a time. Requests made
+// meanwhile replace each other & only the latest one is issued once the one
+// in flight completes, e.g. while a seek bar is being dragged.
+class SeekScheduler {
+ public:
+  struct Seek {
+    int64_t time;
+    SeekMode mode;
+  };
+
+  struct Result {
+    // Microseconds between the seek being issued & its completion.
+    int64_t latency;
+    // Requests replaced by newer ones since the previous completion.
+    int32_t dropped;
+    // Seek to issue next, if any.
+    std::optional<Seek> next;
+  };
+
+  // Returns |seek| if it has to be issued now, otherwise it is queued.
+  std::optional<Seek> Request(Seek seek) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    // A seek may never be reported as complete, e.g. on unseekable medias.
+    if (in_flight_ && now - issue_time_ < kTimeout) {
+      if (pending_) dropped_++;
+      pending_ = seek;
+      return std::nullopt;
+    }
+    in_flight_ = true;
+    issue_time_ = now;
+    return seek;
+  }
+
+  // Called once the seek in flight completed.
+  Result Complete() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    Result result{std::chrono::duration_cast<std::chrono::microseconds>(
+                      now - issue_time_)
+                      .count(),
+                  dropped_, pending_};
+    dropped_ = 0;
+    pending_.reset();
+    in_flight_ = result.next.has_value();
+    issue_time_ = now;
+    return result;
+  }
+
+  // Forgets the seek in flight & the queued one, e.g. when another media is
+  // opened.
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_ = false;
+    pending_.reset();
+    dropped_ = 0;
+  }
+
+ private:
+  static constexpr auto kTimeout = std::chrono::seconds(1);
+
+  std::mutex mutex_;
+  bool in_flight_ = false;
+  std::optional<Seek> pending_;
+  int32_t dropped_ = 0;
+  std::chrono::steady_clock::time_point issue_time_;
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_SEGMENTJANITOR_H_
+#define INTERNAL_SEGMENTJANITOR_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+
+// Follows the segments of a segmented record as the livehttp access closes
+// them, keeps an index mapping wall clock times to them & deletes the ones
+// falling out of the retention window.
+//
+// The index is a text file with a line per segment, oldest first:
+// <number> <start> <duration> <bytes> <name>, times in milliseconds since
+// the epoch. It is replaced atomically, so it only ever lists complete
+// segments which are still on disk.
+class SegmentJanitor {
+ public:
+  static constexpr auto kPlaylist = "playlist.m3u8";
+  static constexpr auto kIndex = "index.txt";
+  // livehttp replaces the run of '#' with the zero padded segment number.
+  static constexpr auto kSegmentPattern = "segment-##########.ts";
+
+  struct Segment {
+    int64_t number;
+    int64_t start;
+    int64_t duration;
+    int64_t bytes;
+    std::string name;
+  };
+
+  // |max_age| in seconds & |max_bytes|, 0 for no limit.
+  SegmentJanitor(std::filesystem::path directory, int64_t max_age,
+                 int64_t max_bytes)
+      : directory_(directory), max_age_(max_age), max_bytes_(max_bytes) {
+    Load();
+  }
+
+  ~SegmentJanitor() { Stop(); }
+
+  // Number of the next segment, so that a restarted record does not
+  // overwrite the segments it wrote before.
+  int64_t next_number() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.empty() ? 1 : segments_.back().number + 1;
+  }
+
+  const std::filesystem::path& directory() const { return directory_; }
+
+  // Follows the playlist written by livehttp until |Stop| is called.
+  void Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) return;
+    is_stopped_ = false;
+    thread_ = std::thread([this]() -> void {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!is_stopped_) {
+        Update();
+        condition_.wait_for(lock, kInterval,
+                            [this]() -> bool { return is_stopped_; });
+      }
+    });
+  }
+
+  // Indexes the segments closed until now, e.g. the last one once the
+  // record is stopped.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = true;
+    }
+    condition_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    Update();
+  }
+
+  // Finds the segment containing |time|, along with the offset of |time|
+  // in it in milliseconds.
+  std::optional<std::pair<Segment, int64_t>> Find(int64_t time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Segment& segment : segments_) {
+      if (time >= segment.start && time < segment.start + segment.duration) {
+        return std::make_pair(segment, time - segment.start);
+      }
+    }
+    return std::nullopt;
+  }
+
+ private:
+  static constexpr auto kInterval = std::chrono::milliseconds(500);
+  // Segments closer than this are considered contiguous.
+  static constexpr int64_t kGapTolerance = 1000;
+
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void Load() {
+    std::ifstream file(directory_ / kIndex);
+    Segment segment;
+    while (file >> segment.number >> segment.start >> segment.duration >>
+           segment.bytes >> segment.name) {
+      segments_.emplace_back(segment);
+      bytes_ += segment.bytes;
+    }
+  }
+
+  // Indexes the segments closed since the previous update & enforces the
+  // retention. Called with |mutex_| held.
+  void Update() {
+    bool changed = false;
+    std::ifstream playlist(directory_ / kPlaylist);
+    std::string line;
+    int64_t duration = 0;
+    while (std::getline(playlist, line)) {
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      if (line.rfind("#EXTINF:", 0) == 0) {
+        duration = static_cast<int64_t>(
+            std::strtod(line.c_str() + 8, nullptr) * 1000.0);
+        continue;
+      }
+      if (line.empty() || line.front() == '#') continue;
+      int64_t number = Number(line);
+      if (number < 0 ||
+          (!segments_.empty() && number <= segments_.back().number)) {
+        continue;
+      }
+      std::error_code code;
+      std::uintmax_t bytes =
+          std::filesystem::file_size(directory_ / line, code);
+      if (code) continue;
+      // livehttp lists a segment right after closing it, its start is
+      // estimated from the time it was found unless it follows the
+      // previous one.
+      int64_t start = Now() - duration;
+      if (!segments_.empty()) {
+        const Segment& previous = segments_.back();
+        int64_t end = previous.start + previous.duration;
+        if (std::abs(start - end) < kGapTolerance) start = end;
+      }
+      segments_.push_back(Segment{number, start, duration,
+                                  static_cast<int64_t>(bytes), line});
+      bytes_ += static_cast<int64_t>(bytes);
+      changed = true;
+    }
+    int64_t now = Now();
+    while (!segments_.empty()) {
+      const Segment& oldest = segments_.front();
+      bool is_expired = max_age_ > 0 && oldest.start + oldest.duration <
+                                            now - max_age_ * 1000;
+      bool is_over_size = max_bytes_ > 0 && bytes_ > max_bytes_;
+      if (!is_expired && !is_over_size) break;
+      std::error_code code;
+      std::filesystem::remove(directory_ / oldest.name, code);
+      bytes_ -= oldest.bytes;
+      segments_.pop_front();
+      changed = true;
+    }
+    if (changed) Write();
+  }
+
+  // Number of the segment |name|, -1 if it is not one.
+  static int64_t Number(const std::string& name) {
+    size_t first = name.find_first_of("0123456789");
+    if (first == std::string::npos) return -1;
+    return std::strtoll(name.c_str() + first, nullptr, 10);
+  }
+
+  void Write() {
+    std::filesystem::path path = directory_ / kIndex;
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+      std::ofstream file(temporary, std::ios::trunc);
+      for (const Segment& segment : segments_) {
+        file << segment.number << ' ' << segment.start << ' '
+             << segment.duration << ' ' << segment.bytes << ' '
+             << segment.name << '\n';
+      }
+      if (!file) return;
+    }
+    std::error_code code;
+    std::filesystem::rename(temporary, path, code);
+  }
+
+  std::filesystem::path directory_;
+  int64_t max_age_;
+  int64_t max_bytes_;
+  std::deque<Segment> segments_;
+  int64_t bytes_ = 0;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool is_stopped_ = false;
+};
+
+#endif
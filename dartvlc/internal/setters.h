@@ -9,118 +9,335 @@
  * GNU Lesser General Public License v2.1
  */
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
 #include "device.h"
 #include "internal/events.h"
+#include "internal/playlistbatch.h"
 #include "mediasource/media.h"
 #include "mediasource/mediasource.h"
 #include "mediasource/playlist.h"
+#include "streamoutput.h"
 
 class PlayerSetters : public PlayerEvents {
  public:
   void Open(std::shared_ptr<MediaSource> media_source, bool auto_start = true) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
     state()->is_started_ = false;
     state()->Reset();
     Stop();
-    state()->medias()->medias() = {};
-    vlc_media_list_ = VLC::MediaList(vlc_instance_);
+    vlc_medias_.clear();
     if (media_source->Type() == "MediaSourceType.media") {
       std::shared_ptr<Media> media =
           std::dynamic_pointer_cast<Media>(media_source);
-      VLC::Media vlc_media = VLC::Media(vlc_instance_, media->location(),
-                                        VLC::Media::FromLocation);
-      vlc_media_list_.addMedia(vlc_media);
-      vlc_media_list_player_.setMediaList(vlc_media_list_);
-      state()->medias()->medias() = {media};
+      state()->medias_.Add(media);
       state()->is_playlist_ = false;
     } else if (media_source->Type() == "MediaSourceType.playlist") {
       std::shared_ptr<Playlist> playlist =
           std::dynamic_pointer_cast<Playlist>(media_source);
       if (playlist->medias().empty()) return;
       for (std::shared_ptr<Media>& media : playlist->medias()) {
-        VLC::Media vlc_media = VLC::Media(vlc_instance_, media->location(),
-                                          VLC::Media::FromLocation);
-        vlc_media_list_.addMedia(vlc_media);
-        state()->medias()->medias().emplace_back(media);
+        state()->medias_.Add(media);
       }
-      vlc_media_list_player_.setMediaList(vlc_media_list_);
       state()->is_playlist_ = true;
     }
-    OnOpenCallback(vlc_media_list_.itemAtIndex(0));
+    int32_t size = static_cast<int32_t>(state()->medias()->size());
+    state()->MarkChanged(0, size);
+    if (is_shuffle_) shuffle_.Reset(size, 0, shuffle_seed_);
+    OnOpenCallback(std::make_shared<VLC::Media>(MediaAt(0)));
     if (auto_start) Play();
   }
 
   void Play() {
-    if (!state()->is_started_ && !state()->medias()->medias().empty()) {
-      vlc_media_list_player_.playItemAtIndex(0);
-      state()->is_started_ = true;
+    if (!state()->is_started_ && !state()->medias()->empty()) {
+      PlayIndex(0);
     } else {
-      vlc_media_list_player_.play();
+      vlc_media_player().play();
     }
   }
 
   void Pause() {
-    if (vlc_media_list_player_.isPlaying()) {
-      vlc_media_list_player_.pause();
+    if (vlc_media_player().isPlaying()) {
+      vlc_media_player().setPause(true);
     }
   }
 
   void PlayOrPause() {
-    if (!state()->is_started_ && !state()->medias()->medias().empty()) {
-      vlc_media_list_player_.playItemAtIndex(0);
-      state()->is_started_ = true;
+    if (!state()->is_started_ && !state()->medias()->empty()) {
+      PlayIndex(0);
     } else {
-      vlc_media_list_player_.pause();
+      vlc_media_player().pause();
     }
   }
 
-  void Stop() { vlc_media_list_player_.stop(); }
+  void Stop() {
+    ResetRecording();
+    CancelCrossfade();
+    DiscardPrefetch();
+    vlc_media_player().stop();
+  }
 
   void Next() {
-    OnPlaylistCallback();
-    if (state()->index_ < vlc_media_list_.count())
-      vlc_media_list_player_.playItemAtIndex(++state()->index_);
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    int32_t index = NextIndex(false);
+    if (index >= 0) PlayIndex(index);
   }
 
   void Back() {
-    OnPlaylistCallback();
-    if (state()->index_ > 0)
-      vlc_media_list_player_.playItemAtIndex(--state()->index_);
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    // When shuffling, go back to the entries actually played first.
+    int32_t index = is_shuffle_ ? shuffle_.Pop() : -1;
+    if (index < 0) index = PreviousIndex();
+    if (index >= 0) PlayIndex(index, false);
   }
 
-  void Jump(int32_t index) {
-    OnPlaylistCallback();
-    if (index >= 0 && index < vlc_media_list_.count())
-      vlc_media_list_player_.playItemAtIndex(index);
+  void Jump(int32_t index) { PlayIndex(index); }
+
+  void Seek(int32_t position) { SeekTime(position * 1000LL); }
+
+  // Seeks to |time| microseconds, reported by |seek_callback_| once reached.
+  // Unlike a relative position, the time keeps its precision on long medias.
+  // While a seek is in flight, newer requests replace the queued one. libVLC
+  // 3 only seeks with millisecond precision & always precisely.
+  void SeekTime(int64_t time, SeekMode mode = SeekMode::precise) {
+    std::optional<SeekScheduler::Seek> seek =
+        seek_scheduler_.Request({std::max<int64_t>(time, 0), mode});
+    if (seek) IssueSeek(*seek);
+  }
+
+  // Seeks while a seek bar is dragged: fast seeks while |is_dragging|, a
+  // precise one once released.
+  void Scrub(int64_t time, bool is_dragging) {
+    SeekTime(time, is_dragging ? SeekMode::fast : SeekMode::precise);
+  }
+
+  // Displays the next video frame & pauses.
+  void NextFrame() { vlc_media_player().nextFrame(); }
+
+  // Pauses & displays the previous video frame, libVLC cannot decode
+  // backwards so it is reached with a precise seek.
+  void PreviousFrame() {
+    if (vlc_media_player().isPlaying()) vlc_media_player().setPause(true);
+    int64_t time = static_cast<int64_t>(vlc_media_player().time()) * 1000;
+    SeekTime(time - FrameDuration(), SeekMode::precise);
+  }
+
+  // Loops [|start|, |end|) microseconds of the current entry |count| times,
+  // 0 for ever, calling |loop_callback_| with each iteration. The region is
+  // cleared once the loops are done, when another entry starts or when
+  // |end| is not after |start|.
+  void SetLoopRegion(int64_t start, int64_t end, int32_t count = 0) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    loop_watcher_.Stop();
+    if (start < 0 || end <= start) return;
+    loop_watcher_.Start(
+        start, end, std::max(0, count),
+        [=]() -> LoopWatcher::Sample {
+          bool is_playing = vlc_media_player().isPlaying();
+          return {static_cast<int64_t>(vlc_media_player().time()) * 1000,
+                  is_playing ? vlc_media_player().rate() : 0.0f};
+        },
+        [=](int32_t iteration) -> void {
+          SeekTime(start, SeekMode::precise);
+          loop_callback_(iteration);
+        });
+  }
+
+  // Records the input of the current entry into |directory| while it keeps
+  // playing, without opening it again or transcoding it, reported by
+  // |recording_callback_|. |mux| is the container, e.g. "ts", "mkv" or
+  // "mp4", libVLC 4 keeps the container of the input instead. Recording
+  // stops with the entry.
+  void StartRecording(const std::string& directory, const std::string& mux) {
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    libvlc_media_player_record(vlc_media_player().get(), true,
+                               directory.c_str());
+#else
+    // libVLC 3 cannot attach a sout to a running input, the entry is
+    // reopened at the current time with its stream duplicated to the file.
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    if (!state()->is_started_ || !recording_path_.empty()) return;
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    std::error_code code;
+    std::filesystem::create_directories(std::filesystem::u8path(directory),
+                                        code);
+    std::string path =
+        (std::filesystem::u8path(directory) /
+         ("record-" + std::to_string(now) + "." + (mux == "ps" ? "mpg" : mux)))
+            .u8string();
+    Reopen({":sout=#duplicate{dst=display,dst=std{access=file,mux=" + mux +
+            ",dst=" + StreamOutputHost::Quote(path) + "}}"});
+    recording_path_ = path;
+    recording_callback_(true, path);
+#endif
   }
 
-  void Seek(int32_t position) {
-    vlc_media_player_.setPosition(static_cast<float>(position) /
-                                  static_cast<float>(duration()));
+  void StopRecording() {
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    libvlc_media_player_record(vlc_media_player().get(), false, nullptr);
+#else
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    if (recording_path_.empty()) return;
+    Reopen({});
+    ResetRecording();
+#endif
   }
 
   void SetVolume(float volume) {
-    vlc_media_player_.setVolume(static_cast<int32_t>(volume * 100));
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    vlc_media_player().setVolume(static_cast<int32_t>(volume * 100));
+    vlc_standby_player().setVolume(static_cast<int32_t>(volume * 100));
     state()->volume_ = volume;
     volume_callback_(volume);
   }
 
   void SetRate(float rate) {
-    vlc_media_player_.setRate(rate);
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    vlc_media_player().setRate(rate);
+    vlc_standby_player().setRate(rate);
     state()->rate_ = rate;
     rate_callback_(rate);
   }
 
   void SetDevice(Device device) {
-    vlc_media_player_.outputDeviceSet(device.id());
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    vlc_media_player().outputDeviceSet(device.id());
+    vlc_standby_player().outputDeviceSet(device.id());
+    for (auto& passthrough : audio_passthroughs_) {
+      if (passthrough) passthrough->SetDevice(device.id());
+    }
+  }
+
+  // Taps the decoded audio from the next entry opened, see |AudioTap|. The
+  // samples no longer reach the audio output unless |passthrough| is true,
+  // in which case each player plays them with an |AudioPassthrough|. The tap
+  // lives as long as the player, later calls return it unchanged but may still
+  // enable the passthrough.
+  AudioTap* EnableAudioTap(int32_t rate, int32_t channels,
+                           AudioTap::Layout layout, int32_t capacity,
+                           bool passthrough = false) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    if (!audio_tap_) {
+      audio_tap_ =
+          std::make_unique<AudioTap>(rate, channels, layout, capacity);
+      audio_tap_->OnFormat([=](int32_t rate, int32_t channels) -> void {
+        audio_format_callback_(rate, channels);
+      });
+      for (VLC::MediaPlayer& player : vlc_players_) {
+        libvlc_media_player_t* raw_player = player.get();
+        audio_tap_->Attach(player,
+                           [=]() -> bool { return IsActive(raw_player); });
+      }
+    }
+    if (passthrough && !audio_passthroughs_[0]) {
+      // Each player keeps its own output, so that the outgoing entry of a
+      // crossfade is still heard while the tap follows the incoming one.
+      for (int32_t index = 0; index < 2; index++) {
+        audio_passthroughs_[index] = std::make_unique<AudioPassthrough>(
+            vlc_instance_, audio_tap_->channels());
+        AudioPassthrough* output = audio_passthroughs_[index].get();
+        audio_tap_->SetOutput(
+            vlc_players_[index].get(),
+            {[=](int32_t rate) -> void {
+               // Negotiated on an audio thread, which must not restart a
+               // player.
+               worker_.Post([=]() -> void { output->Start(rate); });
+             },
+             [=](const float* samples, int32_t frames, int32_t) -> void {
+               output->Write(samples, frames);
+             }});
+        // Plays ahead by the latency of the passthrough, so that its audio
+        // stays in sync with the video of the player.
+        vlc_players_[index].setAudioDelay(-AudioPassthrough::kLatency);
+      }
+    }
+    return audio_tap_.get();
+  }
+
+  // Analyzes the played audio into |bands| log-spaced bands & per channel
+  // levels |frequency| times per second, reported to |analysis_callback_|.
+  // Enables a stereo |AudioTap| with a passthrough, so that the audio keeps
+  // playing, unless a tap is enabled already, which is then analyzed as is.
+  // 0 |bands| stops the analysis.
+  void SetAnalysis(int32_t bands, int32_t fft_size, int32_t frequency) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    if (bands <= 0) {
+      if (audio_analyzer_) audio_analyzer_->Stop();
+      return;
+    }
+    if (!audio_analyzer_) {
+      AudioTap* tap = audio_tap_
+                          ? audio_tap_.get()
+                          : EnableAudioTap(0, 2, AudioTap::interleaved,
+                                           kAnalysisTapCapacity, true);
+      audio_analyzer_ = std::make_unique<AudioAnalyzer>(tap);
+    }
+    audio_analyzer_->Start(
+        bands, fft_size, frequency,
+        [=](const AudioAnalyzer::Analysis& analysis) -> void {
+          analysis_callback_(analysis);
+        });
   }
 
   void SetPlaylistMode(PlaylistMode mode) {
-    vlc_media_list_player_.setPlaybackMode(
-        static_cast<libvlc_playback_mode_t>(mode));
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    playlist_mode_ = mode;
+    // The prefetched entry may not be the next one anymore.
+    DiscardPrefetch();
+  }
+
+  // Fades consecutive entries into each other over |duration| milliseconds
+  // following |curve|. 0 disables crossfades.
+  void SetCrossfade(int32_t duration, Fader::Curve curve = Fader::linear) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    crossfade_ = std::max(0, duration);
+    crossfade_curve_ = curve;
+  }
+
+  // Plays the entries in a random order generated from |seed| (0 for a
+  // random seed) starting from the current entry, without reordering the
+  // playlist. Combines with |playlist_mode_|.
+  void SetShuffle(bool shuffle, uint64_t seed = 0) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    is_shuffle_ = shuffle;
+    shuffle_seed_ = seed;
+    if (is_shuffle_) {
+      shuffle_.Reset(static_cast<int32_t>(state()->medias()->size()),
+                     state()->index_, shuffle_seed_);
+    }
+    DiscardPrefetch();
   }
 
   void SetEqualizer(Equalizer equalizer) {
-    vlc_media_player_.setEqualizer(equalizer.vlc_equalizer_);
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    equalizer_ = equalizer;
+    ApplyNormalization(vlc_media_player(), state()->index_);
+    ApplyNormalization(vlc_standby_player(), standby_index_);
+  }
+
+  // Normalizes the loudness of the entries to |target| LUFS following
+  // |mode|, through the preamp of the equalizer. Entries are measured in the
+  // background by |g_loudness_scanner| ahead of being played.
+  void SetNormalization(LoudnessMode mode, double target = -18.0) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    loudness_mode_ = mode;
+    loudness_target_ = target;
+    ApplyNormalization(vlc_media_player(), state()->index_);
+    ApplyNormalization(vlc_standby_player(), standby_index_);
+  }
+
+  // Prepares each entry |prefetch| milliseconds before the end of the
+  // current one, so that it starts without a gap. 0 disables prefetching.
+  void SetGapless(int32_t prefetch) {
+    gapless_prefetch_ = std::max(0, prefetch);
+    if (!gapless_prefetch_) DiscardPrefetch();
   }
 
   void SetUserAgent(std::string userAgent) {
@@ -128,73 +345,130 @@ class PlayerSetters : public PlayerEvents {
   }
 
   void Add(std::shared_ptr<Media> media) {
-    is_playlist_modified_ = true;
-    VLC::Media vlc_media =
-        VLC::Media(vlc_instance_, media->location(), VLC::Media::FromLocation);
-    vlc_media_list_.addMedia(vlc_media);
-    state()->medias()->medias().emplace_back(media);
-    OnPlaylistCallback();
-    state()->is_playlist_ = true;
+    PlaylistBatch batch;
+    batch.Add(-1, {{media->media_type(), media->resource()}});
+    Apply(batch);
   }
 
   void Remove(int32_t index) {
-    if (index < 0 || index >= state()->medias()->medias().size()) return;
-    is_playlist_modified_ = true;
-    state()->medias()->medias().erase(state()->medias()->medias().begin() +
-                                      index);
-    vlc_media_list_.removeIndex(index);
-    OnPlaylistCallback();
-    if (!state()->is_completed_ && state()->index_ == index) {
-      if (state()->index_ == vlc_media_list_.count()) {
-        vlc_media_list_player_.stop();
-      } else
-        Jump(index);
-    }
-    if (state()->index_ > index) state()->index_--;
-    state()->is_playlist_ = true;
+    PlaylistBatch batch;
+    batch.Remove(index);
+    Apply(batch);
   }
 
   void Insert(int32_t index, std::shared_ptr<Media> media) {
-    if (index < 0 || index >= state()->medias()->medias().size()) return;
-    is_playlist_modified_ = true;
-    VLC::Media vlc_media =
-        VLC::Media(vlc_instance_, media->location(), VLC::Media::FromLocation);
-    vlc_media_list_.insertMedia(vlc_media, index);
-    state()->medias()->medias().insert(
-        state()->medias()->medias().begin() + index, media);
-    OnPlaylistCallback();
-    if (state()->index_ <= index) state()->index_++;
-    state()->is_playlist_ = true;
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    if (index < 0 || index >= state()->medias()->size()) return;
+    PlaylistBatch batch;
+    batch.Add(index, {{media->media_type(), media->resource()}});
+    Apply(batch);
   }
 
   void Move(int32_t initial, int32_t final) {
-    if (initial < 0 || initial >= state()->medias()->medias().size() ||
-        final < 0 || final >= state()->medias()->medias().size())
-      return;
-    if (initial == final) return;
-    is_playlist_modified_ = true;
-    std::shared_ptr<Media> media = state()->medias()->medias()[initial];
-    VLC::Media _media = VLC::Media(
-        vlc_instance_, vlc_media_list_.itemAtIndex(initial).get()->mrl(),
-        VLC::Media::FromLocation);
-    state()->medias()->medias().erase(state()->medias()->medias().begin() +
-                                      initial);
-    vlc_media_list_.removeIndex(initial);
-    state()->medias()->medias().insert(
-        state()->medias()->medias().begin() + final, std::move(media));
-    vlc_media_list_.insertMedia(_media, final);
-    if (initial == state()->index_) {
-      state()->index_ = final;
-    } else if (final == state()->index_) {
-      state()->index_++;
-    } else if (!((initial < state()->index_ && final < state()->index_) ||
-                 (initial > state()->index_ && final > state()->index_))) {
-      if (initial > final)
-        state()->index_++;
-      else
-        state()->index_--;
+    PlaylistBatch batch;
+    batch.Move(initial, final);
+    Apply(batch);
+  }
+
+  // Applies the operations of |batch| in order, then updates the playlist &
+  // notifies once. Operations with out of range indices are skipped.
+  void Apply(const PlaylistBatch& batch) {
+    std::lock_guard<std::recursive_mutex> lock(playlist_mutex_);
+    PlaylistEntries& medias = state()->medias_;
+    int32_t& current = state()->index_;
+    bool is_modified = false;
+    // Whether the entry being played was removed, |current| then refers to
+    // the entry which took its place.
+    bool is_current_removed = false;
+    for (const PlaylistBatch::Operation& operation : batch.operations()) {
+      int32_t size = static_cast<int32_t>(medias.size());
+      auto first = batch.items().begin() + operation.first_item;
+      auto last = first + operation.item_count;
+      switch (operation.type) {
+        case PlaylistBatch::add: {
+          int32_t index = operation.index == -1 ? size : operation.index;
+          if (index < 0 || index > size || first == last) continue;
+          medias.Insert(index, first, last);
+          // Later entries shifted.
+          state()->MarkChanged(index, static_cast<int32_t>(medias.size()));
+          if (index < size && current >= index) {
+            current += static_cast<int32_t>(operation.item_count);
+          }
+          if (is_shuffle_) {
+            shuffle_.Insert(index, static_cast<int32_t>(operation.item_count),
+                            current);
+          }
+          break;
+        }
+        case PlaylistBatch::remove: {
+          int32_t index = operation.index;
+          if (index < 0 || index >= size || operation.count <= 0) continue;
+          int32_t count = std::min(operation.count, size - index);
+          medias.Remove(index, count);
+          state()->MarkChanged(index, size);
+          if (current >= index + count) {
+            current -= count;
+          } else if (current >= index) {
+            current = index;
+            is_current_removed = true;
+          }
+          if (is_shuffle_) shuffle_.Remove(index, count);
+          break;
+        }
+        case PlaylistBatch::move: {
+          int32_t initial = operation.index, final = operation.count;
+          if (initial < 0 || initial >= size || final < 0 || final >= size ||
+              initial == final) {
+            continue;
+          }
+          medias.Move(initial, final);
+          state()->MarkChanged(std::min(initial, final),
+                               std::max(initial, final) + 1);
+          if (initial == current) {
+            current = final;
+          } else if (initial < current && final >= current) {
+            current--;
+          } else if (initial > current && final <= current) {
+            current++;
+          }
+          if (is_shuffle_) shuffle_.Move(initial, final);
+          break;
+        }
+        case PlaylistBatch::replace: {
+          std::string media_type, resource;
+          if (!is_current_removed && current < size) {
+            media_type = medias.media_type(current);
+            resource = medias.resource(current);
+          }
+          medias.Clear();
+          medias.Insert(0, first, last);
+          state()->MarkChanged(0, std::max<int32_t>(size, medias.size()));
+          current = medias.IndexOf(media_type, resource);
+          if (current < 0) {
+            current = 0;
+            is_current_removed = true;
+          }
+          if (is_shuffle_) {
+            shuffle_.Reset(static_cast<int32_t>(medias.size()), current,
+                           shuffle_seed_);
+          }
+          break;
+        }
+      }
+      is_modified = true;
     }
+    if (!is_modified) return;
+    state()->is_playlist_ = true;
+    bool is_past_end = current >= medias.size();
     OnPlaylistCallback();
+    if (is_current_removed && state()->is_started_ &&
+        !state()->is_completed_ && !medias.empty()) {
+      if (is_past_end) {
+        vlc_media_player().stop();
+      } else {
+        PlayIndex(current);
+      }
+    }
   }
 
   void SetVideoWidth(int32_t video_width) {
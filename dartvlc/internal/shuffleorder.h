@@ -0,0 +1,159 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_SHUFFLEORDER_H_
+#define INTERNAL_SHUFFLEORDER_H_
+
+#include <algorithm>
+#include <deque>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Random play order over the indices of a playlist, without reordering the
+// playlist itself. The order is a seeded permutation, so that it can be
+// reproduced, with O(1) lookups of the entries before & after an index. The
+// entries actually played are remembered separately, so that going back
+// follows jumps too.
+//
+// Mutations of the playlist are mirrored with |Insert|, |Remove| & |Move|,
+// each one being linear in the size of the playlist.
+class ShuffleOrder {
+ public:
+  // Creates a new permutation of |size| indices starting with |first| (unless
+  // it is -1) & clears the history. |seed| 0 picks a random seed.
+  void Reset(int32_t size, int32_t first, uint64_t seed = 0) {
+    random_.seed(seed ? seed : std::random_device()());
+    order_.resize(size);
+    std::iota(order_.begin(), order_.end(), 0);
+    std::shuffle(order_.begin(), order_.end(), random_);
+    if (first >= 0 && first < size) {
+      std::swap(*std::find(order_.begin(), order_.end(), first), order_[0]);
+    }
+    history_.clear();
+    Index();
+  }
+
+  // Returns the index played after |index|, or -1 at the end of the order
+  // unless |wrap| is true.
+  int32_t Next(int32_t index, bool wrap) const {
+    if (index < 0 || index >= positions_.size()) return -1;
+    size_t position = positions_[index] + 1;
+    if (position < order_.size()) return order_[position];
+    return wrap ? order_.front() : -1;
+  }
+
+  // Returns the index played before |index| in the order, or -1 at its start
+  // unless |wrap| is true.
+  int32_t Previous(int32_t index, bool wrap) const {
+    if (index < 0 || index >= positions_.size()) return -1;
+    int32_t position = positions_[index];
+    if (position > 0) return order_[position - 1];
+    return wrap ? order_.back() : -1;
+  }
+
+  // Records that |index| was played.
+  void Push(int32_t index) {
+    history_.push_back(index);
+    if (history_.size() > kHistorySize) history_.pop_front();
+  }
+
+  // Returns the last played index & forgets it, or -1.
+  int32_t Pop() {
+    if (history_.empty()) return -1;
+    int32_t index = history_.back();
+    history_.pop_back();
+    return index;
+  }
+
+  // Mirrors the insertion of |count| entries before |index|. New entries are
+  // scattered randomly among the ones following |current| in the order, so
+  // that they have not been played yet.
+  void Insert(int32_t index, int32_t count, int32_t current) {
+    auto shift = [=](int32_t& value) {
+      if (value >= index) value += count;
+    };
+    std::for_each(order_.begin(), order_.end(), shift);
+    std::for_each(history_.begin(), history_.end(), shift);
+    std::vector<int32_t> added(count);
+    std::iota(added.begin(), added.end(), index);
+    std::shuffle(added.begin(), added.end(), random_);
+    auto it = std::find(order_.begin(), order_.end(), current);
+    auto first = it == order_.end() ? order_.begin() : it + 1;
+    // Uniformly random interleaving of the upcoming entries & |added|.
+    std::vector<int32_t> upcoming(first, order_.end());
+    order_.erase(first, order_.end());
+    size_t i = 0, j = 0;
+    while (i < upcoming.size() || j < added.size()) {
+      size_t remaining = upcoming.size() - i + added.size() - j;
+      if (std::uniform_int_distribution<size_t>(1, remaining)(random_) <=
+          upcoming.size() - i) {
+        order_.push_back(upcoming[i++]);
+      } else {
+        order_.push_back(added[j++]);
+      }
+    }
+    Index();
+  }
+
+  // Mirrors the removal of |count| entries starting at |index|.
+  void Remove(int32_t index, int32_t count) {
+    auto is_removed = [=](int32_t value) {
+      return value >= index && value < index + count;
+    };
+    auto shift = [=](int32_t& value) {
+      if (value >= index + count) value -= count;
+    };
+    order_.erase(std::remove_if(order_.begin(), order_.end(), is_removed),
+                 order_.end());
+    history_.erase(
+        std::remove_if(history_.begin(), history_.end(), is_removed),
+        history_.end());
+    std::for_each(order_.begin(), order_.end(), shift);
+    std::for_each(history_.begin(), history_.end(), shift);
+    Index();
+  }
+
+  // Mirrors the move of entry |initial| to |final|. The play order of the
+  // moved entry is kept.
+  void Move(int32_t initial, int32_t final) {
+    auto remap = [=](int32_t& value) {
+      if (value == initial) {
+        value = final;
+      } else if (initial < final && value > initial && value <= final) {
+        value--;
+      } else if (initial > final && value >= final && value < initial) {
+        value++;
+      }
+    };
+    std::for_each(order_.begin(), order_.end(), remap);
+    std::for_each(history_.begin(), history_.end(), remap);
+    Index();
+  }
+
+ private:
+  static constexpr size_t kHistorySize = 1024;
+
+  // Rebuilds |positions_|, the inverse permutation of |order_|.
+  void Index() {
+    positions_.resize(order_.size());
+    for (size_t position = 0; position < order_.size(); position++) {
+      positions_[order_[position]] = static_cast<int32_t>(position);
+    }
+  }
+
+  std::mt19937_64 random_;
+  std::vector<int32_t> order_;
+  std::vector<int32_t> positions_;
+  std::deque<int32_t> history_;
+};
+
+#endif
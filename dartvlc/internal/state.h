@@ -9,16 +9,17 @@
  * GNU Lesser General Public License v2.1
  */
 
+#include <algorithm>
 #include <memory>
 
-#include "mediasource/playlist.h"
 #include "device.h"
 #include "equalizer.h"
+#include "internal/playlistentries.h"
 
 class PlayerState {
  public:
   void Reset() {
-    medias_->medias().clear();
+    medias_.Clear();
     index_ = 0;
     is_playing_ = false;
     is_valid_ = true;
@@ -27,10 +28,12 @@ class PlayerState {
     position_ = 0;
     duration_ = 0;
     is_started_ = false;
+    changed_start_ = 0;
+    changed_end_ = 0;
   }
 
   int32_t index() const { return index_; };
-  Playlist* medias() const { return medias_.get(); };
+  const PlaylistEntries* medias() const { return &medias_; };
   bool is_playing() const { return is_playing_; };
   bool is_valid() const { return is_valid_; };
   bool is_seekable() const { return is_seekable_; };
@@ -41,11 +44,32 @@ class PlayerState {
   float rate() const { return rate_; }
   bool is_playlist() const { return is_playlist_; };
   bool is_started() const { return is_started_; };
+  // Range [|changed_start()|, |changed_end()|) of |medias()| modified since
+  // the last open event. |changed_end()| may exceed the current size once
+  // entries were removed.
+  int32_t changed_start() const { return changed_start_; };
+  int32_t changed_end() const { return changed_end_; };
 
  protected:
+  // Extends the changed range to [|start|, |end|).
+  void MarkChanged(int32_t start, int32_t end) {
+    if (start >= end) return;
+    if (changed_start_ >= changed_end_) {
+      changed_start_ = start;
+      changed_end_ = end;
+    } else {
+      changed_start_ = std::min(changed_start_, start);
+      changed_end_ = std::max(changed_end_, end);
+    }
+  }
+
+  void ClearChanged() {
+    changed_start_ = 0;
+    changed_end_ = 0;
+  }
+
   int32_t index_ = 0;
-  std::unique_ptr<Playlist> medias_ =
-      std::make_unique<Playlist>(std::vector<std::shared_ptr<Media>>{});
+  PlaylistEntries medias_;
   bool is_playing_ = false;
   bool is_valid_ = true;
   bool is_seekable_ = true;
@@ -56,6 +80,8 @@ class PlayerState {
   float rate_ = 1.0;
   bool is_playlist_ = false;
   bool is_started_ = false;
+  int32_t changed_start_ = 0;
+  int32_t changed_end_ = 0;
 
   friend class PlayerSetters;
   friend class PlayerEvents;
@@ -0,0 +1,86 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_THREADPOOL_H_
+#define INTERNAL_THREADPOOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of threads running posted tasks in FIFO order. A pool of a
+// single thread runs its tasks serially. Pending tasks are discarded when the
+// pool is stopped or destroyed, running ones are waited for.
+class ThreadPool {
+ public:
+  static size_t DefaultSize() {
+    return std::max<size_t>(4, std::thread::hardware_concurrency());
+  }
+
+  ThreadPool(size_t size = DefaultSize()) {
+    for (size_t index = 0; index < size; index++) {
+      threads_.emplace_back(&ThreadPool::Run, this);
+    }
+  }
+
+  ~ThreadPool() { Stop(); }
+
+  // Discards pending tasks & waits for running ones. Tasks posted afterwards
+  // are ignored. Must not be called from a task.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = true;
+      tasks_.clear();
+    }
+    condition_.notify_all();
+    for (std::thread& thread : threads_) {
+      if (thread.joinable()) thread.join();
+    }
+  }
+
+  void Post(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (is_stopped_) return;
+      tasks_.emplace_back(std::move(task));
+    }
+    condition_.notify_one();
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock,
+                        [this] { return is_stopped_ || !tasks_.empty(); });
+        if (is_stopped_) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::function<void()>> tasks_;
+  std::vector<std::thread> threads_;
+  bool is_stopped_ = false;
+};
+
+#endif
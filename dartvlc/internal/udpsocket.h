@@ -0,0 +1,143 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef INTERNAL_UDPSOCKET_H_
+#define INTERNAL_UDPSOCKET_H_
+
+#include <chrono>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// UDP socket bound to an ephemeral port of the loopback interface, used to
+// receive the output of a stream output job in process.
+class UdpSocket {
+ public:
+  // Size in bytes of the requested receive buffer.
+  static constexpr int32_t kReceiveBuffer = 4 * 1024 * 1024;
+
+  UdpSocket() {
+#ifdef _WIN32
+    WSADATA data;
+    is_initialized_ = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    if (!is_initialized_) return;
+#endif
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_ == kInvalid) return;
+    // Loopback does not drop datagrams in flight but a full receive buffer
+    // does, e.g. while a clip is being written.
+    int32_t size = kReceiveBuffer;
+    setsockopt(socket_, SOL_SOCKET, SO_RCVBUF,
+               reinterpret_cast<const char*>(&size), sizeof(size));
+    // Linux silently caps the size to net.core.rmem_max & reports twice the
+    // granted size, which includes the bookkeeping overhead.
+    socklen_t size_length = sizeof(receive_buffer_);
+    if (getsockopt(socket_, SOL_SOCKET, SO_RCVBUF,
+                   reinterpret_cast<char*>(&receive_buffer_),
+                   &size_length) != 0) {
+      receive_buffer_ = 0;
+    }
+#ifdef __linux__
+    receive_buffer_ /= 2;
+#endif
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (bind(socket_, reinterpret_cast<sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+        getsockname(socket_, reinterpret_cast<sockaddr*>(&address),
+                    &length) != 0) {
+      Close();
+      return;
+    }
+    port_ = ntohs(address.sin_port);
+  }
+
+  UdpSocket(const UdpSocket&) = delete;
+  UdpSocket& operator=(const UdpSocket&) = delete;
+
+  ~UdpSocket() {
+    Close();
+#ifdef _WIN32
+    if (is_initialized_) WSACleanup();
+#endif
+  }
+
+  // 0 if the socket could not be bound.
+  uint16_t port() const { return port_; }
+
+  // Size in bytes of the receive buffer granted by the system, less than
+  // |kReceiveBuffer| if it was capped, 0 if unknown.
+  int32_t receive_buffer() const { return receive_buffer_; }
+
+  // Waits up to |timeout| for a datagram & copies it into |buffer|. Returns
+  // its size, 0 if none arrived.
+  int32_t Receive(uint8_t* buffer, int32_t size,
+                  std::chrono::milliseconds timeout) {
+    if (socket_ == kInvalid) return 0;
+    fd_set sockets;
+    FD_ZERO(&sockets);
+    FD_SET(socket_, &sockets);
+    timeval wait{};
+    wait.tv_sec = static_cast<long>(timeout.count() / 1000);
+    wait.tv_usec = static_cast<long>(timeout.count() % 1000 * 1000);
+    if (select(static_cast<int>(socket_ + 1), &sockets, nullptr, nullptr,
+               &wait) <= 0) {
+      return 0;
+    }
+    auto received =
+        recv(socket_, reinterpret_cast<char*>(buffer), size, 0);
+    return received > 0 ? static_cast<int32_t>(received) : 0;
+  }
+
+ private:
+#ifdef _WIN32
+  typedef SOCKET Handle;
+  static constexpr Handle kInvalid = INVALID_SOCKET;
+#else
+  typedef int Handle;
+  static constexpr Handle kInvalid = -1;
+#endif
+
+  void Close() {
+    if (socket_ == kInvalid) return;
+#ifdef _WIN32
+    closesocket(socket_);
+#else
+    close(socket_);
+#endif
+    socket_ = kInvalid;
+  }
+
+  Handle socket_ = kInvalid;
+  uint16_t port_ = 0;
+  int32_t receive_buffer_ = 0;
+#ifdef _WIN32
+  bool is_initialized_ = false;
+#endif
+};
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef KEYFRAMES_H_
+#define KEYFRAMES_H_
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "internal/keyframescanner.h"
+#include "internal/threadpool.h"
+#include "mediasource/media.h"
+
+// Keyframe times of a local file, used by fast seeks to land on a keyframe
+// in files whose container has no usable index.
+struct KeyframeIndex {
+  std::vector<Keyframe> keyframes;
+
+  // Returns the last keyframe at or before |time| microseconds, or nullptr.
+  const Keyframe* Find(int64_t time) const {
+    auto it = std::upper_bound(
+        keyframes.begin(), keyframes.end(), time,
+        [](int64_t time, const Keyframe& keyframe) -> bool {
+          return time < keyframe.time;
+        });
+    return it == keyframes.begin() ? nullptr : &*(it - 1);
+  }
+};
+
+// Builds keyframe indices in the background & persists them in |g_cache|
+// alongside the metadata of the medias.
+class KeyframeIndexer {
+ public:
+  // Called with the index, nullptr if the media could not be indexed.
+  typedef std::function<void(std::shared_ptr<const KeyframeIndex> index)>
+      Callback;
+
+  // Returns the index of |media| if it was built before.
+  std::shared_ptr<const KeyframeIndex> Get(std::shared_ptr<Media> media) {
+    if (!g_cache->enabled() || media->media_type() != Media::kMediaTypeFile) {
+      return nullptr;
+    }
+    std::optional<CacheRecord> record =
+        g_cache->Read(media->cache_key(), kCacheExtension);
+    auto index = std::make_shared<KeyframeIndex>();
+    uint32_t count = 0;
+    if (!record || !record->Get(count)) return nullptr;
+    index->keyframes.resize(count);
+    for (Keyframe& keyframe : index->keyframes) {
+      if (!record->Get(keyframe.time)) return nullptr;
+    }
+    return index;
+  }
+
+  // Scans |media| in the background if it has not been indexed yet. Only
+  // MPEG-TS & AVI files are supported. |callback| is invoked on a worker
+  // thread.
+  void Request(std::shared_ptr<Media> media, Callback callback) {
+    pool_.Post([=]() -> void {
+      std::shared_ptr<const KeyframeIndex> index = Get(media);
+      if (!index) index = Build(media);
+      callback(index);
+    });
+  }
+
+ private:
+  static constexpr auto kCacheExtension = ".keyframes";
+
+  std::shared_ptr<const KeyframeIndex> Build(std::shared_ptr<Media> media) {
+    if (!g_cache->enabled() || media->media_type() != Media::kMediaTypeFile) {
+      return nullptr;
+    }
+    std::optional<std::vector<Keyframe>> keyframes =
+        KeyframeScanner::Scan(std::filesystem::u8path(media->resource()));
+    if (!keyframes || keyframes->empty()) return nullptr;
+    auto index = std::make_shared<KeyframeIndex>();
+    index->keyframes = std::move(*keyframes);
+    CacheRecord record;
+    record.Put(static_cast<uint32_t>(index->keyframes.size()));
+    for (const Keyframe& keyframe : index->keyframes) {
+      record.Put(keyframe.time);
+    }
+    g_cache->Write(media->cache_key(), kCacheExtension, record);
+    return index;
+  }
+
+  // Scans are I/O bound, possibly over network storage.
+  ThreadPool pool_{1};
+};
+
+extern std::unique_ptr<KeyframeIndexer> g_keyframe_indexer;
+
+#endif
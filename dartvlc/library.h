@@ -0,0 +1,462 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef LIBRARY_H_
+#define LIBRARY_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "cache.h"
+#include "internal/threadpool.h"
+#include "mediasource/media.h"
+
+// Indexes the medias found inside a set of directories. The first |Scan| walks
+// the directories in parallel & parses every new or modified file into
+// |g_cache|. The state of the index is persisted in the cache, so later scans
+// only parse what changed in between. On Linux the directories are then
+// watched with inotify & changes are applied incrementally. Symlinked
+// directories are never followed, they may form loops. Requires an enabled
+// |g_cache|, without which nothing would be kept.
+class Library {
+ public:
+  static constexpr auto kChangeAdded = "added";
+  static constexpr auto kChangeModified = "modified";
+  static constexpr auto kChangeRemoved = "removed";
+  // Reported with a directory which could not be watched, e.g. once the
+  // inotify watch limit of the user is reached. Its changes are only picked
+  // up by the next scan.
+  static constexpr auto kChangeUnwatched = "unwatched";
+
+  typedef std::function<void(int32_t scanned, int32_t parsed, bool completed)>
+      ProgressCallback;
+  typedef std::function<void(const char* change, const std::string& path)>
+      ChangeCallback;
+
+  Library(std::vector<std::string> directories,
+          std::vector<std::string> extensions, bool sniff)
+      : sniff_(sniff) {
+    for (const std::string& directory : directories) {
+      directories_.emplace_back(std::filesystem::u8path(directory));
+    }
+    for (std::string extension : extensions) {
+      if (!extension.empty() && extension[0] != '.') {
+        extension.insert(extension.begin(), '.');
+      }
+      extensions_.insert(Lowercase(extension));
+    }
+    std::string identity;
+    for (const std::string& directory : directories) {
+      identity += directory + '\0';
+    }
+    index_key_ = Cache::Hash(identity);
+    ReadIndex();
+  }
+
+  ~Library() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = true;
+    }
+    if (watch_thread_.joinable()) watch_thread_.join();
+  }
+
+  void OnProgress(ProgressCallback callback) { progress_callback_ = callback; }
+
+  void OnChange(ChangeCallback callback) { change_callback_ = callback; }
+
+  // Starts an asynchronous scan. If |watch| is true, the directories are
+  // watched for changes once the scan is complete.
+  void Scan(bool watch) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (is_scanning_) return;
+      // Held until the directories are posted, so that parses still running
+      // for |Watch| cannot complete the scan before any file was seen.
+      pending_++;
+      is_scanning_ = true;
+      watch_ = watch;
+      scanned_ = 0;
+      parsed_ = 0;
+      seen_.clear();
+    }
+    for (const std::filesystem::path& directory : directories_) {
+      Post([=]() { ScanDirectory(directory); });
+    }
+    Release();
+  }
+
+ private:
+  struct Entry {
+    uint64_t size = 0;
+    int64_t modified = 0;
+  };
+
+  static constexpr auto kIndexExtension = ".library";
+  static constexpr int32_t kParseTimeout = 10000;
+  // Changes applied while watching are persisted at most this often.
+  static constexpr auto kIndexWriteInterval = std::chrono::seconds(2);
+  // Metadata parsed for indexed files: everything but the (slow) network
+  // lookups, which are never performed while indexing.
+  static constexpr uint32_t kParseMask = Media::kMetaAll;
+
+  static std::string Lowercase(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return value;
+  }
+
+  // Runs |task| on the pool, tracking outstanding work so that the end of a
+  // scan can be detected.
+  void Post(std::function<void()> task) {
+    pending_++;
+    pool_.Post([=]() {
+      task();
+      Release();
+    });
+  }
+
+  void Release() {
+    if (--pending_ == 0) OnScanCompleted();
+  }
+
+  void ScanDirectory(const std::filesystem::path& directory) {
+    std::error_code error;
+    for (auto it = std::filesystem::directory_iterator(directory, error);
+         !error && it != std::filesystem::directory_iterator();
+         it.increment(error)) {
+      if (is_stopped_) return;
+      std::error_code status_error;
+      if (it->is_directory(status_error)) {
+        if (it->is_symlink(status_error)) continue;
+        std::filesystem::path path = it->path();
+        Post([=]() { ScanDirectory(path); });
+      } else if (it->is_regular_file(status_error)) {
+        ScanFile(it->path());
+      }
+    }
+  }
+
+  void ScanFile(const std::filesystem::path& path) {
+    if (!IsMedia(path)) return;
+    std::error_code error;
+    Entry entry;
+    entry.size = std::filesystem::file_size(path, error);
+    if (error) return;
+    entry.modified = std::filesystem::last_write_time(path, error)
+                         .time_since_epoch()
+                         .count();
+    if (error) return;
+    std::string key = path.u8string();
+    const char* change = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (is_scanning_) seen_.insert(key);
+      auto it = index_.find(key);
+      if (it == index_.end()) {
+        change = kChangeAdded;
+      } else if (it->second.size != entry.size ||
+                 it->second.modified != entry.modified) {
+        change = kChangeModified;
+      }
+    }
+    scanned_++;
+    if (!change) return;
+    Post([=]() {
+      Media::file(key)->parse(kParseTimeout, kParseMask, false);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_[key] = entry;
+      }
+      // Written by |OnScanCompleted| during a scan, by |Watch| otherwise.
+      if (!is_scanning_) is_index_dirty_ = true;
+      parsed_++;
+      change_callback_(change, key);
+      if (parsed_ % 64 == 0) progress_callback_(scanned_, parsed_, false);
+    });
+  }
+
+  bool IsMedia(const std::filesystem::path& path) {
+    if (extensions_.empty() && !sniff_) return true;
+    if (extensions_.count(Lowercase(path.extension().u8string()))) return true;
+    return sniff_ && Sniff(path);
+  }
+
+  // Recognizes common audio & video containers by their leading bytes.
+  static bool Sniff(const std::filesystem::path& path) {
+    uint8_t header[189] = {};
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+      return false;
+    }
+    auto starts_with = [&](const char* magic, size_t offset = 0) {
+      return memcmp(header + offset, magic, strlen(magic)) == 0;
+    };
+    return starts_with("ID3") || starts_with("fLaC") || starts_with("OggS") ||
+           starts_with("RIFF") || starts_with("ftyp", 4) ||
+           starts_with("\x1A\x45\xDF\xA3") || starts_with("MThd") ||
+           (header[0] == 0x47 && header[188] == 0x47) ||
+           (header[0] == 0xFF && (header[1] & 0xE0) == 0xE0);
+  }
+
+  void OnScanCompleted() {
+    // An interrupted scan has not seen every file, keep the index as is.
+    if (!is_scanning_ || is_stopped_) return;
+    std::vector<std::string> removed;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = index_.begin(); it != index_.end();) {
+        if (!seen_.count(it->first)) {
+          removed.emplace_back(it->first);
+          it = index_.erase(it);
+        } else {
+          it++;
+        }
+      }
+      seen_.clear();
+    }
+    for (const std::string& path : removed) {
+      change_callback_(kChangeRemoved, path);
+    }
+    WriteIndex();
+    progress_callback_(scanned_, parsed_, true);
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_scanning_ = false;
+    if (watch_ && !is_stopped_ && !watch_thread_.joinable()) {
+      watch_thread_ = std::thread(&Library::Watch, this);
+    }
+  }
+
+  void ReadIndex() {
+    std::optional<CacheRecord> record =
+        g_cache->Read(index_key_, kIndexExtension);
+    uint32_t count = 0;
+    if (!record || !record->Get(count)) return;
+    for (uint32_t index = 0; index < count; index++) {
+      std::string path;
+      Entry entry;
+      if (!record->Get(path) || !record->Get(entry.size) ||
+          !record->Get(entry.modified)) {
+        index_.clear();
+        return;
+      }
+      index_.emplace(std::move(path), entry);
+    }
+  }
+
+  void WriteIndex() {
+    CacheRecord record;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      record.Put(static_cast<uint32_t>(index_.size()));
+      for (const auto & [ path, entry ] : index_) {
+        record.Put(path);
+        record.Put(entry.size);
+        record.Put(entry.modified);
+      }
+    }
+    g_cache->Write(index_key_, kIndexExtension, record);
+  }
+
+#ifdef __linux__
+  void Watch() {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+      for (const std::filesystem::path& directory : directories_) {
+        change_callback_(kChangeUnwatched, directory.u8string());
+      }
+      return;
+    }
+    std::unordered_map<int, std::filesystem::path> watches;
+    std::function<void(const std::filesystem::path&)> add_watches =
+        [&](const std::filesystem::path& directory) {
+          int wd = inotify_add_watch(
+              fd, directory.c_str(),
+              IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM |
+                  IN_MOVED_TO | IN_ONLYDIR);
+          if (wd < 0) {
+            change_callback_(kChangeUnwatched, directory.u8string());
+            return;
+          }
+          watches[wd] = directory;
+          std::error_code error;
+          for (auto it = std::filesystem::directory_iterator(directory, error);
+               !error && it != std::filesystem::directory_iterator();
+               it.increment(error)) {
+            std::error_code status_error;
+            if (it->is_directory(status_error) &&
+                !it->is_symlink(status_error)) {
+              add_watches(it->path());
+            }
+          }
+        };
+    for (const std::filesystem::path& directory : directories_) {
+      add_watches(directory);
+    }
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    auto last_write = std::chrono::steady_clock::now();
+    while (!is_stopped_) {
+      pollfd descriptor{fd, POLLIN, 0};
+      if (poll(&descriptor, 1, 250) > 0) {
+        ReadEvents(fd, buffer, sizeof(buffer), watches, add_watches);
+      }
+      auto now = std::chrono::steady_clock::now();
+      if (now - last_write >= kIndexWriteInterval &&
+          is_index_dirty_.exchange(false)) {
+        WriteIndex();
+        last_write = now;
+      }
+    }
+    if (is_index_dirty_.exchange(false)) WriteIndex();
+    close(fd);
+  }
+
+  void ReadEvents(
+      int fd, char* buffer, size_t buffer_size,
+      std::unordered_map<int, std::filesystem::path>& watches,
+      const std::function<void(const std::filesystem::path&)>& add_watches) {
+    ssize_t size = read(fd, buffer, buffer_size);
+    for (char* pointer = buffer; size > 0 && pointer < buffer + size;) {
+      auto event = reinterpret_cast<struct inotify_event*>(pointer);
+      pointer += sizeof(struct inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        // Events were dropped, only a full scan can tell what changed.
+        // Directories created in between are watched again first, adding a
+        // watch twice returns the existing one.
+        for (const std::filesystem::path& directory : directories_) {
+          add_watches(directory);
+        }
+        Scan(true);
+        continue;
+      }
+      auto it = watches.find(event->wd);
+      if (it == watches.end() || !event->len) continue;
+      std::filesystem::path path = it->second / event->name;
+      if (event->mask & IN_ISDIR) {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+          // Files may have been created before the watch was added.
+          add_watches(path);
+          Post([=]() { ScanDirectory(path); });
+        } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+          if (RemovePrefix(path.u8string() + '/')) is_index_dirty_ = true;
+        }
+      } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+        ScanFile(path);
+      } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        if (RemovePrefix(path.u8string())) is_index_dirty_ = true;
+      }
+    }
+  }
+
+  // Drops |prefix| & every path below it from the index.
+  bool RemovePrefix(const std::string& prefix) {
+    std::vector<std::string> removed;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = index_.lower_bound(prefix);
+           it != index_.end() &&
+           it->first.compare(0, prefix.size(), prefix) == 0;) {
+        removed.emplace_back(it->first);
+        it = index_.erase(it);
+      }
+    }
+    for (const std::string& path : removed) {
+      change_callback_(kChangeRemoved, path);
+    }
+    return !removed.empty();
+  }
+#else
+  void Watch() {}
+#endif
+
+  std::vector<std::filesystem::path> directories_;
+  std::set<std::string> extensions_;
+  bool sniff_;
+  std::string index_key_;
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> index_;
+  std::set<std::string> seen_;
+
+  std::atomic<bool> is_scanning_ = false;
+  std::atomic<bool> is_stopped_ = false;
+  std::atomic<bool> is_index_dirty_ = false;
+  std::atomic<int32_t> pending_ = 0;
+  std::atomic<int32_t> scanned_ = 0;
+  std::atomic<int32_t> parsed_ = 0;
+  bool watch_ = false;
+  std::thread watch_thread_;
+
+  ProgressCallback progress_callback_ = [](int32_t, int32_t, bool) -> void {};
+  ChangeCallback change_callback_ = [](const char*,
+                                       const std::string&) -> void {};
+
+  // Declared last, so that running tasks finish before any other member is
+  // destroyed.
+  ThreadPool pool_;
+};
+
+class Libraries {
+ public:
+  Library* Get(int32_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = libraries_.find(id);
+    return it == libraries_.end() ? nullptr : it->second.get();
+  }
+
+  Library* Create(int32_t id, std::vector<std::string> directories,
+                  std::vector<std::string> extensions, bool sniff) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, added] = libraries_.try_emplace(id, nullptr);
+    if (added) {
+      it->second = std::make_unique<Library>(directories, extensions, sniff);
+    }
+    return it->second.get();
+  }
+
+  void Dispose(int32_t id) {
+    std::unique_ptr<Library> library;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = libraries_.find(id);
+      if (it == libraries_.end()) return;
+      library = std::move(it->second);
+      libraries_.erase(it);
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<int32_t, std::unique_ptr<Library>> libraries_;
+};
+
+extern std::unique_ptr<Libraries> g_libraries;
+
+#endif
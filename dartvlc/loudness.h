@@ -0,0 +1,219 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef LOUDNESS_H_
+#define LOUDNESS_H_
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "internal/audiodecoder.h"
+#include "internal/loudnessmeter.h"
+#include "internal/threadpool.h"
+#include "mediasource/media.h"
+
+// How the played entries are normalized: not at all, each to the target
+// loudness, or each album as a whole keeping the differences between its
+// tracks.
+enum LoudnessMode : int32_t { noGain, trackGain, albumGain };
+
+// EBU R128 measurements of a media.
+struct Loudness {
+  // LUFS.
+  double integrated;
+  // LU.
+  double range;
+  // dBTP.
+  double true_peak;
+  // Sum & count of the gated block powers, so that the loudness of several
+  // medias can be combined, see |Loudness::Combine|.
+  double gated_power;
+  uint64_t gated_blocks;
+
+  // Merges the measurements of |other| as if both medias were played one
+  // after the other.
+  void Combine(const Loudness& other) {
+    gated_power += other.gated_power;
+    gated_blocks += other.gated_blocks;
+    integrated = gated_blocks
+                     ? LoudnessMeter::Loudness(gated_power / gated_blocks)
+                     : LoudnessMeter::kSilence;
+    range = std::max(range, other.range);
+    true_peak = std::max(true_peak, other.true_peak);
+  }
+};
+
+// Measures the loudness of local files in the background, decoding faster
+// than real time, & persists it in |g_cache| alongside the metadata of the
+// medias.
+class LoudnessScanner {
+ public:
+  // Called with the measurements, std::nullopt if the media could not be
+  // decoded.
+  typedef std::function<void(std::optional<Loudness> loudness)> Callback;
+
+  // Running scans are interrupted rather than waited for.
+  ~LoudnessScanner() { decoders_.Stop(); }
+
+  // Returns the loudness of |media| if it was measured before.
+  std::optional<Loudness> Get(std::shared_ptr<Media> media) {
+    if (!g_cache->enabled() || media->media_type() != Media::kMediaTypeFile) {
+      return std::nullopt;
+    }
+    std::optional<CacheRecord> record =
+        g_cache->Read(media->cache_key(), kCacheExtension);
+    Loudness loudness;
+    if (!record || !record->Get(loudness.integrated) ||
+        !record->Get(loudness.range) || !record->Get(loudness.true_peak) ||
+        !record->Get(loudness.gated_power) ||
+        !record->Get(loudness.gated_blocks)) {
+      return std::nullopt;
+    }
+    return loudness;
+  }
+
+  // Measures |media| in the background unless it was measured or is queued
+  // already, e.g. ahead of playing it.
+  void Prepare(std::shared_ptr<Media> media) {
+    if (!g_cache->enabled() || media->media_type() != Media::kMediaTypeFile) {
+      return;
+    }
+    std::string key = media->cache_key();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!pending_.insert(key).second) return;
+    }
+    pool_.Post([=]() -> void {
+      if (!Get(media)) Scan(media);
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.erase(key);
+    });
+  }
+
+  // Returns the combined loudness of |medias|, e.g. the tracks of an album,
+  // once every file among them was measured. Their measurements are read &
+  // combined on the pool, the result is kept in memory. Until then the
+  // missing ones are measured & std::nullopt is returned.
+  std::optional<Loudness> GetCombined(
+      const std::vector<std::shared_ptr<Media>>& medias) {
+    std::string key;
+    for (const std::shared_ptr<Media>& media : medias) {
+      key += media->location() + '\0';
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = combined_.find(key);
+      if (it != combined_.end()) return it->second;
+      if (!pending_.insert(key).second) return std::nullopt;
+    }
+    pool_.Post([=]() -> void {
+      std::optional<Loudness> combined;
+      bool is_complete = true;
+      for (const std::shared_ptr<Media>& media : medias) {
+        if (media->media_type() != Media::kMediaTypeFile) continue;
+        std::optional<Loudness> loudness = Get(media);
+        if (!loudness) {
+          is_complete = false;
+          Prepare(media);
+        } else if (combined) {
+          combined->Combine(*loudness);
+        } else {
+          combined = loudness;
+        }
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.erase(key);
+      if (is_complete && combined) combined_.emplace(key, *combined);
+    });
+    return std::nullopt;
+  }
+
+  // Groups the medias of an album: their album tag, or their directory for
+  // untagged files. Entries of a playlist are not parsed, so the tag is read
+  // from the metadata cached by an earlier parse, e.g. by a |Library| scan.
+  // Files which were never parsed are grouped by their directory.
+  static std::string AlbumKey(std::shared_ptr<Media> media) {
+    if (!media->metas().count("album")) {
+      media->ReadCached(1u << Media::kMetaAlbum);
+    }
+    auto album = media->metas().find("album");
+    if (album != media->metas().end() && !album->second.empty()) {
+      return album->second;
+    }
+    return std::filesystem::u8path(media->resource())
+        .parent_path()
+        .u8string();
+  }
+
+  // Measures |media| in the background if it was not measured yet. Only
+  // files are supported, streams may never end. |callback| is invoked on a
+  // worker thread.
+  void Request(std::shared_ptr<Media> media, Callback callback) {
+    pool_.Post([=]() -> void {
+      std::optional<Loudness> loudness = Get(media);
+      if (!loudness) loudness = Scan(media);
+      callback(loudness);
+    });
+  }
+
+ private:
+  static constexpr auto kCacheExtension = ".loud";
+
+  std::optional<Loudness> Scan(std::shared_ptr<Media> media) {
+    if (!g_cache->enabled() || media->media_type() != Media::kMediaTypeFile) {
+      return std::nullopt;
+    }
+    static_assert(AudioDecoder::kRate == LoudnessMeter::kRate &&
+                  AudioDecoder::kChannels == LoudnessMeter::kChannels);
+    LoudnessMeter meter;
+    AudioDecoder decoder(
+        media->location(),
+        [&](const float* samples, size_t frames) -> void {
+          meter.Add(samples, frames);
+        },
+        &decoders_);
+    if (!decoder.Decode()) return std::nullopt;
+    auto [gated_power, gated_blocks] = meter.GatedPower();
+    Loudness loudness{meter.IntegratedLoudness(), meter.LoudnessRange(),
+                      meter.TruePeak(), gated_power, gated_blocks};
+    CacheRecord record;
+    record.Put(loudness.integrated);
+    record.Put(loudness.range);
+    record.Put(loudness.true_peak);
+    record.Put(loudness.gated_power);
+    record.Put(loudness.gated_blocks);
+    g_cache->Write(media->cache_key(), kCacheExtension, record);
+    return loudness;
+  }
+
+  std::mutex mutex_;
+  // Keys of the medias queued by |Prepare| & of the medias combined by
+  // |GetCombined|.
+  std::set<std::string> pending_;
+  // Measurements combined by |GetCombined|, keyed by the locations of the
+  // medias.
+  std::map<std::string, Loudness> combined_;
+  AudioDecoderGroup decoders_;
+  // Decoding is CPU bound, two scans run in parallel.
+  ThreadPool pool_{2};
+};
+
+extern std::unique_ptr<LoudnessScanner> g_loudness_scanner;
+
+#endif
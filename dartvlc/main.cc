@@ -1,10 +1,38 @@
+#include "artwork.h"
 #include "broadcast.h"
+#include "cache.h"
+#include "chromecast.h"
+#include "device.h"
 #include "equalizer.h"
+#include "keyframes.h"
+#include "library.h"
+#include "loudness.h"
 #include "player.h"
 #include "record.h"
+#include "streamoutput.h"
+#include "thumbnails.h"
+#include "waveform.h"
 
 // TODO: Reduce amount of ugly global variables
+// Used by the players, so defined first & destroyed after them.
+std::unique_ptr<Cache> g_cache = std::make_unique<Cache>();
+std::unique_ptr<KeyframeIndexer> g_keyframe_indexer =
+    std::make_unique<KeyframeIndexer>();
+std::unique_ptr<LoudnessScanner> g_loudness_scanner =
+    std::make_unique<LoudnessScanner>();
+std::unique_ptr<WaveformGenerator> g_waveform_generator =
+    std::make_unique<WaveformGenerator>();
 std::unique_ptr<Players> g_players = std::make_unique<Players>();
 std::unique_ptr<Equalizers> g_equalizers = std::make_unique<Equalizers>();
+// Outlives the jobs of |g_broadcasts|, |g_records| & |g_chromecasts|.
+std::unique_ptr<StreamOutputHost> g_stream_output_host =
+    std::make_unique<StreamOutputHost>();
 std::unique_ptr<Broadcasts> g_broadcasts = std::make_unique<Broadcasts>();
-std::unique_ptr<Records> g_records = std::make_unique<Records>();
\ No newline at end of file
+std::unique_ptr<Records> g_records = std::make_unique<Records>();
+std::unique_ptr<Chromecasts> g_chromecasts = std::make_unique<Chromecasts>();
+std::unique_ptr<Libraries> g_libraries = std::make_unique<Libraries>();
+std::unique_ptr<ArtworkCache> g_artwork_cache =
+    std::make_unique<ArtworkCache>();
+std::unique_ptr<ThumbnailCache> g_thumbnail_cache =
+    std::make_unique<ThumbnailCache>();
+std::unique_ptr<Devices> g_devices = std::make_unique<Devices>();
@@ -12,14 +12,18 @@
 #ifndef MEDIASOURCE_MEDIA_H_
 #define MEDIASOURCE_MEDIA_H_
 
+#include <cstring>
 #include <filesystem>
 #include <future>
 #include <map>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <vlcpp/vlc.hpp>
 
+#include "cache.h"
 #include "mediasource/mediasource.h"
+#include "mediasource/trackinfo.h"
 
 class Media : public MediaSource {
  public:
@@ -31,6 +35,7 @@ class Media : public MediaSource {
   std::string& resource() { return resource_; };
   std::string& location() { return location_; };
   std::map<std::string, std::string>& metas() { return metas_; };
+  std::vector<TrackInfo>& tracks() { return tracks_; };
 
   static std::shared_ptr<Media> create(std::string_view type,
                                        const std::string& url,
@@ -72,52 +77,184 @@ class Media : public MediaSource {
     return media;
   }
 
-  void parse(int32_t timeout) {
-    VLC::Instance vlc_instance = VLC::Instance(0, nullptr);
+  // Metadata fields retrievable by |parse|, indexed by their bit in a request
+  // mask. |meta| is the matching |libvlc_meta_t| or -1 for fields which are
+  // not stored as libVLC metadata.
+  struct MetaField {
+    const char* key;
+    int32_t meta;
+  };
 
+  static constexpr int32_t kMetaCount = 24;
+  static constexpr uint32_t kMetaAll = (1u << kMetaCount) - 1;
+  static constexpr int32_t kMetaAlbum = 4;
+  static constexpr int32_t kMetaArtworkUrl = 14;
+  static constexpr int32_t kMetaDuration = kMetaCount - 1;
+  static constexpr MetaField kMetaFields[kMetaCount] = {
+      {"title", libvlc_meta_Title},
+      {"artist", libvlc_meta_Artist},
+      {"genre", libvlc_meta_Genre},
+      {"copyright", libvlc_meta_Copyright},
+      {"album", libvlc_meta_Album},
+      {"trackNumber", libvlc_meta_TrackNumber},
+      {"description", libvlc_meta_Description},
+      {"rating", libvlc_meta_Rating},
+      {"date", libvlc_meta_Date},
+      {"settings", libvlc_meta_Setting},
+      {"url", libvlc_meta_URL},
+      {"language", libvlc_meta_Language},
+      {"nowPlaying", libvlc_meta_NowPlaying},
+      {"encodedBy", libvlc_meta_EncodedBy},
+      {"artworkUrl", libvlc_meta_ArtworkURL},
+      {"trackTotal", libvlc_meta_TrackTotal},
+      {"director", libvlc_meta_Director},
+      {"season", libvlc_meta_Season},
+      {"episode", libvlc_meta_Episode},
+      {"actors", libvlc_meta_Actors},
+      {"albumArtist", libvlc_meta_AlbumArtist},
+      {"discNumber", libvlc_meta_DiscNumber},
+      {"discTotal", libvlc_meta_DiscTotal},
+      {"duration", -1},
+  };
+
+  // Parses the media & fills |metas_| with the fields selected by |mask| and
+  // |tracks_| with its elementary streams. Network lookups (e.g. online
+  // artwork or metadata) are only performed if |network| is true. If
+  // |fetch_artwork| is true, embedded artworks are extracted to the art cache
+  // of libVLC & "artworkUrl" points to the extracted file instead of an
+  // `attachment://` URL. Results for local files are served from & stored in
+  // |g_cache| when it is enabled.
+  void parse(int32_t timeout, uint32_t mask = kMetaAll, bool network = true,
+             bool fetch_artwork = false) {
+    std::string key;
+    if (media_type_ == kMediaTypeFile && g_cache->enabled()) {
+      key = Cache::Key(location_, resource_);
+      // Entries stored by parses which did not fetch the artwork still refer
+      // to the attachment.
+      if (ReadCache(key, mask) &&
+          !(fetch_artwork && HasAttachedArtwork())) {
+        return;
+      }
+    }
     VLC::Media media =
-        VLC::Media(vlc_instance, location_, VLC::Media::FromLocation);
+        VLC::Media(ParserInstance(), location_, VLC::Media::FromLocation);
     std::promise<bool> is_parsed = std::promise<bool>();
     auto is_parsed_ptr = &is_parsed;
     media.eventManager().onParsedChanged(
         [is_parsed_ptr](VLC::Media::ParsedStatus status) -> void {
           is_parsed_ptr->set_value(true);
         });
-    media.parseWithOptions(VLC::Media::ParseFlags::Network, timeout);
+    VLC::Media::ParseFlags flags = network ? VLC::Media::ParseFlags::Network
+                                           : VLC::Media::ParseFlags::Local;
+    if (fetch_artwork) flags = flags | VLC::Media::ParseFlags::FetchLocal;
+    media.parseWithOptions(flags, timeout);
     is_parsed_ptr->get_future().wait();
-    metas_["title"] = media.meta(libvlc_meta_Title);
-    metas_["artist"] = media.meta(libvlc_meta_Artist);
-    metas_["genre"] = media.meta(libvlc_meta_Genre);
-    metas_["copyright"] = media.meta(libvlc_meta_Copyright);
-    metas_["album"] = media.meta(libvlc_meta_Album);
-    metas_["trackNumber"] = media.meta(libvlc_meta_TrackNumber);
-    metas_["description"] = media.meta(libvlc_meta_Description);
-    metas_["rating"] = media.meta(libvlc_meta_Rating);
-    metas_["date"] = media.meta(libvlc_meta_Date);
-    metas_["settings"] = media.meta(libvlc_meta_Setting);
-    metas_["url"] = media.meta(libvlc_meta_URL);
-    metas_["language"] = media.meta(libvlc_meta_Language);
-    metas_["nowPlaying"] = media.meta(libvlc_meta_NowPlaying);
-    metas_["encodedBy"] = media.meta(libvlc_meta_EncodedBy);
-    metas_["artworkUrl"] = media.meta(libvlc_meta_ArtworkURL);
-    metas_["trackTotal"] = media.meta(libvlc_meta_TrackTotal);
-    metas_["director"] = media.meta(libvlc_meta_Director);
-    metas_["season"] = media.meta(libvlc_meta_Season);
-    metas_["episode"] = media.meta(libvlc_meta_Episode);
-    metas_["actors"] = media.meta(libvlc_meta_Actors);
-    metas_["albumArtist"] = media.meta(libvlc_meta_AlbumArtist);
-    metas_["discNumber"] = media.meta(libvlc_meta_DiscNumber);
-    metas_["discTotal"] = media.meta(libvlc_meta_DiscTotal);
-    metas_["duration"] = std::to_string(media.duration());
+    for (int32_t index = 0; index < kMetaCount; index++) {
+      if (!(mask & (1u << index))) continue;
+      const MetaField& field = kMetaFields[index];
+      if (index == kMetaDuration) {
+        metas_[field.key] = std::to_string(media.duration());
+      } else {
+        metas_[field.key] = media.meta(static_cast<libvlc_meta_t>(field.meta));
+      }
+    }
+    tracks_.clear();
+    for (const VLC::MediaTrack& track : media.tracks()) {
+      tracks_.emplace_back(track);
+    }
+    if (!key.empty()) WriteCache(key, mask);
+  }
+
+  // Fills |metas_| with the fields selected by |mask| from |g_cache|, without
+  // parsing the media. Returns false if they were not cached.
+  bool ReadCached(uint32_t mask) {
+    if (media_type_ != kMediaTypeFile || !g_cache->enabled()) return false;
+    return ReadCache(cache_key(), mask);
+  }
+
+  // Returns the key of this media's entries in |g_cache|.
+  std::string cache_key() const {
+    return Cache::Key(location_,
+                      media_type_ == kMediaTypeFile ? resource_ : "");
   }
 
   std::string Type() { return "MediaSourceType.media"; }
 
  private:
+  static constexpr auto kCacheExtension = ".meta";
+  static constexpr auto kAttachmentScheme = "attachment://";
+
+  // Shared by all parses, so that plugins are only loaded once instead of on
+  // every parsed file.
+  static VLC::Instance& ParserInstance() {
+    static VLC::Instance instance = VLC::Instance(0, nullptr);
+    return instance;
+  }
+
+  bool HasAttachedArtwork() const {
+    auto artwork = metas_.find("artworkUrl");
+    return artwork != metas_.end() &&
+           artwork->second.compare(0, strlen(kAttachmentScheme),
+                                   kAttachmentScheme) == 0;
+  }
+
+  bool ReadCache(const std::string& key, uint32_t mask) {
+    std::optional<CacheRecord> record = g_cache->Read(key, kCacheExtension);
+    uint32_t cached_mask = 0, meta_count = 0, track_count = 0;
+    if (!record || !record->Get(cached_mask) ||
+        (cached_mask & mask) != mask || !record->Get(meta_count)) {
+      return false;
+    }
+    std::map<std::string, std::string> metas;
+    for (uint32_t index = 0; index < meta_count; index++) {
+      std::string meta_key, value;
+      if (!record->Get(meta_key) || !record->Get(value)) return false;
+      metas[meta_key] = std::move(value);
+    }
+    if (!record->Get(track_count)) return false;
+    std::vector<TrackInfo> tracks(track_count);
+    for (TrackInfo& track : tracks) {
+      if (!track.Deserialize(*record)) return false;
+    }
+    for (int32_t index = 0; index < kMetaCount; index++) {
+      if (!(mask & (1u << index))) continue;
+      metas_[kMetaFields[index].key] = metas[kMetaFields[index].key];
+    }
+    tracks_ = std::move(tracks);
+    return true;
+  }
+
+  void WriteCache(const std::string& key, uint32_t mask) {
+    // Keep the fields cached by previous calls requesting a different mask.
+    std::map<std::string, std::string> metas = metas_;
+    std::optional<CacheRecord> previous = g_cache->Read(key, kCacheExtension);
+    uint32_t previous_mask = 0, meta_count = 0;
+    if (previous && previous->Get(previous_mask) &&
+        previous->Get(meta_count)) {
+      for (uint32_t index = 0; index < meta_count; index++) {
+        std::string meta_key, value;
+        if (!previous->Get(meta_key) || !previous->Get(value)) break;
+        metas.try_emplace(meta_key, std::move(value));
+      }
+      mask |= previous_mask;
+    }
+    CacheRecord record;
+    record.Put(mask);
+    record.Put(static_cast<uint32_t>(metas.size()));
+    for (const auto & [ meta_key, value ] : metas) {
+      record.Put(meta_key);
+      record.Put(value);
+    }
+    record.Put(static_cast<uint32_t>(tracks_.size()));
+    for (const TrackInfo& track : tracks_) track.Serialize(record);
+    g_cache->Write(key, kCacheExtension, record);
+  }
+
   std::string media_type_;
   std::string resource_;
   std::string location_;
   std::map<std::string, std::string> metas_;
+  std::vector<TrackInfo> tracks_;
 };
 
 #endif
@@ -0,0 +1,104 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef MEDIASOURCE_TRACKINFO_H_
+#define MEDIASOURCE_TRACKINFO_H_
+
+#include <cstdint>
+#include <string>
+#include <vlcpp/vlc.hpp>
+
+#include "cache.h"
+
+// Technical information about an elementary stream of a media, as reported by
+// libVLC after parsing. Fields which do not apply to the track's type are 0.
+class TrackInfo {
+ public:
+  enum Type : int32_t { unknown = -1, audio, video, subtitle };
+
+  Type type() const { return type_; }
+  uint32_t codec() const { return codec_; }
+  int32_t width() const { return width_; }
+  int32_t height() const { return height_; }
+  float frame_rate() const { return frame_rate_; }
+  int32_t bitrate() const { return bitrate_; }
+  int32_t channels() const { return channels_; }
+  int32_t sample_rate() const { return sample_rate_; }
+  const std::string& language() const { return language_; }
+
+  TrackInfo() = default;
+
+  TrackInfo(const VLC::MediaTrack& track) {
+    codec_ = track.codec();
+    bitrate_ = static_cast<int32_t>(track.bitrate());
+    language_ = track.language();
+    switch (track.type()) {
+      case VLC::MediaTrack::Type::Audio: {
+        type_ = audio;
+        channels_ = static_cast<int32_t>(track.channels());
+        sample_rate_ = static_cast<int32_t>(track.rate());
+        break;
+      }
+      case VLC::MediaTrack::Type::Video: {
+        type_ = video;
+        width_ = static_cast<int32_t>(track.width());
+        height_ = static_cast<int32_t>(track.height());
+        if (track.fpsDen() > 0) {
+          frame_rate_ = static_cast<float>(track.fpsNum()) /
+                        static_cast<float>(track.fpsDen());
+        }
+        break;
+      }
+      case VLC::MediaTrack::Type::Subtitle: {
+        type_ = subtitle;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  void Serialize(CacheRecord& record) const {
+    record.Put(static_cast<int32_t>(type_));
+    record.Put(codec_);
+    record.Put(width_);
+    record.Put(height_);
+    record.Put(frame_rate_);
+    record.Put(bitrate_);
+    record.Put(channels_);
+    record.Put(sample_rate_);
+    record.Put(language_);
+  }
+
+  bool Deserialize(CacheRecord& record) {
+    int32_t type = unknown;
+    bool result = record.Get(type) && record.Get(codec_) &&
+                  record.Get(width_) && record.Get(height_) &&
+                  record.Get(frame_rate_) && record.Get(bitrate_) &&
+                  record.Get(channels_) && record.Get(sample_rate_) &&
+                  record.Get(language_);
+    type_ = static_cast<Type>(type);
+    return result;
+  }
+
+ private:
+  Type type_ = unknown;
+  uint32_t codec_ = 0;
+  int32_t width_ = 0;
+  int32_t height_ = 0;
+  float frame_rate_ = 0.0f;
+  int32_t bitrate_ = 0;
+  int32_t channels_ = 0;
+  int32_t sample_rate_ = 0;
+  std::string language_;
+};
+
+#endif
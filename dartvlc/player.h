@@ -38,15 +38,22 @@ class Player : public PlayerSetters {
       vlc_instance_ =
           VLC::Instance(static_cast<int32_t>(cmd_arguments.size()), args.get());
     }
-    vlc_media_player_ = VLC::MediaPlayer(vlc_instance_);
-    vlc_media_list_player_ = VLC::MediaListPlayer(vlc_instance_);
-    vlc_media_list_ = VLC::MediaList(vlc_instance_);
-    vlc_media_list_player_.setMediaPlayer(vlc_media_player_);
+    for (VLC::MediaPlayer& player : vlc_players_) {
+      player = VLC::MediaPlayer(vlc_instance_);
+      player.setVolume(100);
+    }
     state_ = std::make_unique<PlayerState>();
-    vlc_media_player_.setVolume(100);
+    for (VLC::MediaPlayer& player : vlc_players_) AttachEvents(player);
   }
 
-  ~Player() { vlc_media_player_.stop(); }
+  ~Player() {
+    loop_watcher_.Stop();
+    worker_.Stop();
+    fader_.Cancel();
+    vlc_standby_player().stop();
+    vlc_media_player().stop();
+    if (audio_analyzer_) audio_analyzer_->Stop();
+  }
 };
 
 class Players {
@@ -12,43 +12,166 @@
 #ifndef RECORD_H_
 #define RECORD_H_
 
+#include <filesystem>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <system_error>
 
+#include "internal/prerollrecorder.h"
+#include "internal/segmentjanitor.h"
 #include "mediasource/media.h"
+#include "streamoutput.h"
+
+// Splits a record into |duration| seconds MPEG-TS segments, cut on
+// keyframes, keeping those not older than |max_age| seconds & at most
+// |max_bytes| in total, 0 for no limit.
+struct RecordSegmentation {
+  int32_t duration;
+  int64_t max_age;
+  int64_t max_bytes;
+};
+
+// Keeps the last |duration| seconds of the stream in memory, at most
+// |max_bytes|, & only writes clips starting with them once triggered, see
+// |PrerollRecorder|.
+struct RecordPreroll {
+  int32_t duration;
+  int64_t max_bytes;
+};
 
 class Record {
  public:
-  Record(std::shared_ptr<Media> media, std::string saving_file)
-      : media_(media), saving_file_(saving_file) {
-    ;
-    vlc_instance_ = VLC::Instance(0, nullptr);
-  }
+  // Called with the path of each complete clip of a pre-roll record.
+  typedef PrerollRecorder::ClipCallback ClipCallback;
+
+  // With |segmentation| or |preroll|, |saving_file| is the directory of the
+  // segments or clips.
+  Record(std::shared_ptr<Media> media, std::string saving_file,
+         std::optional<RecordSegmentation> segmentation = std::nullopt,
+         std::optional<RecordPreroll> preroll = std::nullopt)
+      : media_(media),
+        saving_file_(saving_file),
+        segmentation_(segmentation),
+        preroll_(preroll) {}
 
   void Start() {
-    std::stringstream sout;
-    sout << "#std{access=file,mux=raw,dst=" << saving_file_ << "}";
-    libvlc_vlm_add_broadcast(vlc_instance_.get(), media_->location().c_str(),
-                             media_->location().c_str(), sout.str().c_str(), 0,
-                             nullptr, true, false);
-    libvlc_vlm_play_media(vlc_instance_.get(), media_->location().c_str());
+    // The segment numbers are only set when the job is created, a restarted
+    // segmented record must not overwrite its previous segments.
+    if (segmentation_) {
+      job_.reset();
+      if (janitor_) janitor_->Stop();
+    }
+    if (!job_) {
+      job_ = g_stream_output_host->Create(media_->location(), Sout());
+      job_->OnState(state_callback_);
+      if (!segmentation_ && !preroll_) {
+        job_->SetOutputFile(std::filesystem::u8path(saving_file_));
+      }
+    }
+    if (job_->Play() && janitor_) janitor_->Start();
+  }
+
+  // Writes a clip of the pre-roll followed by the next |post| seconds, or
+  // extends the clip being written. Only for pre-roll records.
+  void Trigger(int32_t post) {
+    if (preroll_recorder_) preroll_recorder_->Trigger(post);
+  }
+
+  // Bytes are not reported for segmented & pre-roll records.
+  StreamOutputJob::Stats stats() {
+    if (job_) return job_->stats();
+    return StreamOutputJob::IdleStats();
   }
 
-  ~Record() { libvlc_vlm_release(vlc_instance_.get()); }
+  // Finds the segment recorded at |time|, in milliseconds since the epoch,
+  // & the offset of |time| in it. Returns an empty path if there is none.
+  std::filesystem::path FindSegment(int64_t time, int64_t* offset) {
+    *offset = 0;
+    if (!janitor_) return std::filesystem::path();
+    auto segment = janitor_->Find(time);
+    if (!segment) return std::filesystem::path();
+    *offset = segment->second;
+    return janitor_->directory() / segment->first.name;
+  }
+
+  void OnState(StreamOutputJob::Callback callback) {
+    state_callback_ = callback;
+  }
+
+  void OnClip(ClipCallback callback) { clip_callback_ = callback; }
 
  private:
-  std::string saving_file_;
-  VLC::Instance vlc_instance_;
+  std::string Sout() {
+    std::stringstream sout;
+    if (preroll_) {
+      // The stream is received in process, remuxed to TS without
+      // transcoding.
+      if (!preroll_recorder_) {
+        preroll_recorder_ = std::make_unique<PrerollRecorder>(
+            std::filesystem::u8path(saving_file_), preroll_->duration,
+            preroll_->max_bytes, [this](const std::string& path) -> void {
+              if (clip_callback_) clip_callback_(path);
+            });
+      }
+      sout << "#std{access=udp,mux=ts,dst=127.0.0.1:"
+           << preroll_recorder_->port() << "}";
+      return sout.str();
+    }
+    if (!segmentation_) {
+      sout << "#std{access=file,mux=raw,dst="
+           << StreamOutputHost::Quote(saving_file_) << "}";
+      return sout.str();
+    }
+    std::filesystem::path directory = std::filesystem::u8path(saving_file_);
+    std::error_code code;
+    std::filesystem::create_directories(directory, code);
+    if (!janitor_) {
+      janitor_ = std::make_unique<SegmentJanitor>(
+          directory, segmentation_->max_age, segmentation_->max_bytes);
+    }
+    // livehttp writes the playlist atomically, only listing closed
+    // segments. It is kept short, the janitor indexes segments as soon as
+    // they are listed & deletes them itself.
+    sout << "#std{access=livehttp{seglen=" << segmentation_->duration
+         << ",splitanywhere=false,delsegs=false,numsegs="
+         << kPlaylistSegments << ",initial-segment-number="
+         << janitor_->next_number() << ",index="
+         << StreamOutputHost::Quote(
+                (directory / SegmentJanitor::kPlaylist).u8string())
+         << ",index-url=" << SegmentJanitor::kSegmentPattern
+         << "},mux=ts,dst="
+         << StreamOutputHost::Quote(
+                (directory / SegmentJanitor::kSegmentPattern).u8string())
+         << "}";
+    return sout.str();
+  }
+
+  static constexpr int32_t kPlaylistSegments = 16;
+
   std::shared_ptr<Media> media_;
+  std::string saving_file_;
+  std::optional<RecordSegmentation> segmentation_;
+  std::optional<RecordPreroll> preroll_;
+  StreamOutputJob::Callback state_callback_;
+  ClipCallback clip_callback_;
+  // Declared before |job_|, so that it indexes the last segment once the
+  // job is destroyed.
+  std::unique_ptr<SegmentJanitor> janitor_;
+  std::unique_ptr<PrerollRecorder> preroll_recorder_;
+  std::unique_ptr<StreamOutputJob> job_;
 };
 
 class Records {
  public:
-  Record* Get(int id, std::shared_ptr<Media> media, std::string saving_file) {
+  Record* Get(int id, std::shared_ptr<Media> media, std::string saving_file,
+              std::optional<RecordSegmentation> segmentation = std::nullopt,
+              std::optional<RecordPreroll> preroll = std::nullopt) {
     auto it = records_.find(id);
     if (it == records_.end()) {
-      records_[id] = std::make_unique<Record>(media, saving_file);
+      records_[id] = std::make_unique<Record>(media, saving_file,
+                                              segmentation, preroll);
     }
     return records_[id].get();
   }
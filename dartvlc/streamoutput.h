@@ -0,0 +1,252 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef STREAMOUTPUT_H_
+#define STREAMOUTPUT_H_
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <vlcpp/vlc.hpp>
+
+// Stream output job of |StreamOutputHost|: a media player of its instance,
+// reading the input with the sout chain as a media option. The player is
+// stopped when the job is destroyed.
+class StreamOutputJob {
+ public:
+  enum State : int32_t { idle, opening, playing, paused, ended, error };
+
+  // Polled status of the job. Counters & bitrates come from the statistics
+  // libVLC keeps for the input, -1 where the running libVLC does not report
+  // them. Bitrates are in bits per second.
+  struct Stats {
+    State state = idle;
+    // [0, 1], -1 if the job is not running.
+    float position = -1.0f;
+    // Milliseconds, -1 if the job is not running.
+    int64_t time = -1;
+    int64_t length = -1;
+    float rate = 0.0f;
+    // Read from the input by the access & by the demuxer.
+    int64_t read_bytes = -1;
+    double input_bitrate = 0.0;
+    int64_t demux_read_bytes = -1;
+    double demux_bitrate = 0.0;
+    int64_t demux_corrupted = -1;
+    // Blocks decoded, e.g. before transcoding.
+    int64_t decoded_video = -1;
+    int64_t decoded_audio = -1;
+    int64_t lost_pictures = -1;
+    int64_t late_pictures = -1;
+    int64_t lost_audio_buffers = -1;
+    // Sent by the stream output, libVLC 3 only.
+    int64_t sent_bytes = -1;
+    double send_bitrate = 0.0;
+    // Size of the output file, -1 if the output is not a file.
+    int64_t bytes = -1;
+    // Written to the output file since the previous poll.
+    double bitrate = 0.0;
+  };
+
+  // Reported before the job is started.
+  static Stats IdleStats() { return Stats(); }
+
+  // Invoked from a libVLC thread on each change of state.
+  typedef std::function<void(State state)> Callback;
+
+  inline StreamOutputJob(VLC::Instance& instance, const std::string& input,
+                         const std::string& output,
+                         const std::vector<std::string>& options, bool loop);
+
+  StreamOutputJob(const StreamOutputJob&) = delete;
+  StreamOutputJob& operator=(const StreamOutputJob&) = delete;
+
+  ~StreamOutputJob() {
+    // Destroyed jobs report nothing, not even being stopped.
+    OnState(nullptr);
+    vlc_media_player_.stop();
+  }
+
+  State state() const { return status_->state; }
+
+  void OnState(Callback callback) {
+    std::lock_guard<std::mutex> lock(status_->mutex);
+    status_->callback = callback;
+  }
+
+  // File written by the job, used to report the bytes written.
+  void SetOutputFile(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    output_file_ = path;
+  }
+
+  // Returns false & moves to |State::error| if the job could not be
+  // started.
+  inline bool Play();
+
+  bool Stop() {
+    vlc_media_player_.stop();
+    return true;
+  }
+
+  inline Stats stats();
+
+ private:
+  // Shared with the event handlers of the player, which may still run while
+  // the job is destroyed.
+  struct Status {
+    std::atomic<State> state = idle;
+    std::mutex mutex;
+    Callback callback;
+
+    void Set(State value) {
+      State previous = state.exchange(value);
+      if (previous == value) return;
+      std::lock_guard<std::mutex> lock(mutex);
+      if (callback) callback(value);
+    }
+  };
+
+  std::shared_ptr<Status> status_ = std::make_shared<Status>();
+  VLC::Media vlc_media_;
+  VLC::MediaPlayer vlc_media_player_;
+  std::mutex stats_mutex_;
+  std::filesystem::path output_file_;
+  int64_t last_bytes_ = 0;
+  std::chrono::steady_clock::time_point last_poll_;
+};
+
+// Owns the libVLC instance running every Broadcast, Record & Chromecast job,
+// so that plugins are loaded once & each job only costs its own pipeline.
+class StreamOutputHost {
+ public:
+  // Creates a job reading |input| into the |output| sout chain, started by
+  // |StreamOutputJob::Play|. |loop| repeats the input until the job is stopped.
+  std::unique_ptr<StreamOutputJob> Create(
+      const std::string& input, const std::string& output,
+      const std::vector<std::string>& options = {}, bool loop = false) {
+    return std::make_unique<StreamOutputJob>(instance(), input, output,
+                                             options, loop);
+  }
+
+  // Quotes the value of an option of a sout chain, which may contain the
+  // separators of the chain, e.g. in paths.
+  static std::string Quote(const std::string& value) {
+    std::string quoted = "\"";
+    for (char character : value) {
+      if (character == '"' || character == '\\') quoted += '\\';
+      quoted += character;
+    }
+    return quoted + "\"";
+  }
+
+  VLC::Instance& instance() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!vlc_instance_) {
+      vlc_instance_ = std::make_unique<VLC::Instance>(0, nullptr);
+    }
+    return *vlc_instance_;
+  }
+
+ private:
+  std::mutex mutex_;
+  // Created on first use.
+  std::unique_ptr<VLC::Instance> vlc_instance_;
+};
+
+StreamOutputJob::StreamOutputJob(VLC::Instance& instance,
+                                 const std::string& input,
+                                 const std::string& output,
+                                 const std::vector<std::string>& options,
+                                 bool loop)
+    : vlc_media_(instance, input, VLC::Media::FromLocation) {
+  vlc_media_.addOption(":sout=" + output);
+  for (const std::string& option : options) vlc_media_.addOption(option);
+  if (loop) vlc_media_.addOption(":input-repeat=65535");
+  vlc_media_player_ = VLC::MediaPlayer(vlc_media_);
+  std::shared_ptr<Status> status = status_;
+  auto& event_manager = vlc_media_player_.eventManager();
+  event_manager.onOpening([=]() -> void { status->Set(opening); });
+  event_manager.onPlaying([=]() -> void { status->Set(playing); });
+  event_manager.onPaused([=]() -> void { status->Set(paused); });
+  event_manager.onEndReached([=]() -> void { status->Set(ended); });
+  event_manager.onEncounteredError([=]() -> void { status->Set(error); });
+  event_manager.onStopped([=]() -> void {
+    // Keep the reason of jobs which ended or failed.
+    State state = status->state;
+    if (state != ended && state != error) status->Set(idle);
+  });
+}
+
+bool StreamOutputJob::Play() {
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    last_bytes_ = 0;
+    last_poll_ = std::chrono::steady_clock::now();
+  }
+  if (!vlc_media_player_.play()) {
+    status_->Set(error);
+    return false;
+  }
+  return true;
+}
+
+StreamOutputJob::Stats StreamOutputJob::stats() {
+  Stats stats = IdleStats();
+  stats.state = status_->state;
+  stats.position = vlc_media_player_.position();
+  stats.time = vlc_media_player_.time();
+  stats.length = vlc_media_player_.length();
+  stats.rate = stats.time >= 0 ? vlc_media_player_.rate() : 0.0f;
+  libvlc_media_stats_t media_stats;
+  if (vlc_media_.stats(&media_stats)) {
+    // libVLC reports bitrates in bytes per microsecond.
+    constexpr double kBitsPerSecond = 8.0 * 1000000.0;
+    stats.read_bytes = media_stats.i_read_bytes;
+    stats.input_bitrate = media_stats.f_input_bitrate * kBitsPerSecond;
+    stats.demux_read_bytes = media_stats.i_demux_read_bytes;
+    stats.demux_bitrate = media_stats.f_demux_bitrate * kBitsPerSecond;
+    stats.demux_corrupted = media_stats.i_demux_corrupted;
+    stats.decoded_video = media_stats.i_decoded_video;
+    stats.decoded_audio = media_stats.i_decoded_audio;
+    stats.lost_pictures = media_stats.i_lost_pictures;
+    stats.lost_audio_buffers = media_stats.i_lost_abuffers;
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    stats.late_pictures = media_stats.i_late_pictures;
+#else
+    stats.sent_bytes = media_stats.i_sent_bytes;
+    stats.send_bitrate = media_stats.f_send_bitrate * kBitsPerSecond;
+#endif
+  }
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  if (output_file_.empty()) return stats;
+  std::error_code code;
+  std::uintmax_t size = std::filesystem::file_size(output_file_, code);
+  stats.bytes = code ? 0 : static_cast<int64_t>(size);
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - last_poll_).count();
+  if (elapsed > 0.0) {
+    stats.bitrate = (stats.bytes - last_bytes_) * 8.0 / elapsed;
+  }
+  last_bytes_ = stats.bytes;
+  last_poll_ = now;
+  return stats;
+}
+
+extern std::unique_ptr<StreamOutputHost> g_stream_output_host;
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef THUMBNAILS_H_
+#define THUMBNAILS_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "internal/framegrabber.h"
+#include "internal/threadpool.h"
+#include "mediasource/media.h"
+
+// Thumbnails of a video taken every |interval| milliseconds, packed into
+// sprite sheets of |ThumbnailCache::kColumns| x |ThumbnailCache::kRows|
+// tiles.
+struct ThumbnailStrip {
+  struct Thumbnail {
+    // Milliseconds.
+    int64_t time;
+    // Index in |sheets| & position of the tile inside that sheet.
+    int32_t sheet;
+    int32_t x;
+    int32_t y;
+  };
+
+  int32_t width = 0;
+  int32_t height = 0;
+  std::vector<std::string> sheets;
+  std::vector<Thumbnail> thumbnails;
+};
+
+// Generates & caches thumbnail strips for scrub previews. Generating a strip
+// opens the media once, without audio & decoding keyframes only, and fast
+// seeks to each interval, so that every tile is the keyframe closest to its
+// time. Sheets are stored as uncompressed 32-bit BMPs, which Flutter decodes
+// without any further processing, i.e. |width| x |height| x 4 bytes per tile:
+// about 6 MB per full sheet of 160 x 90 tiles, or 20 MB per hour of video at
+// one such tile every 10 s.
+class ThumbnailCache {
+ public:
+  static constexpr int32_t kColumns = 10;
+  static constexpr int32_t kRows = 10;
+
+  // Called with the generated strip, which is empty on failure.
+  typedef std::function<void(const ThumbnailStrip& strip)> Callback;
+
+  // Returns the cached strip of |media|, without touching the media itself.
+  std::optional<ThumbnailStrip> Get(std::shared_ptr<Media> media,
+                                    int32_t interval, int32_t width) {
+    if (!g_cache->enabled()) return std::nullopt;
+    return ReadIndex(Key(media, interval, width));
+  }
+
+  // Generates the strip of |media| in the background if it is not cached
+  // yet. |callback| is invoked on a worker thread.
+  void Request(std::shared_ptr<Media> media, int32_t interval, int32_t width,
+               Callback callback) {
+    pool_.Post([=]() -> void {
+      if (!g_cache->enabled() || interval <= 0 || width <= 0) {
+        callback(ThumbnailStrip());
+        return;
+      }
+      std::string key = Key(media, interval, width);
+      std::optional<ThumbnailStrip> strip = ReadIndex(key);
+      if (!strip) strip = Generate(media, key, interval, width);
+      callback(strip.value_or(ThumbnailStrip()));
+    });
+  }
+
+ private:
+  static constexpr auto kIndexExtension = ".thumbs";
+  static constexpr int32_t kParseTimeout = 10000;
+  // Milliseconds to wait for a tile after seeking.
+  static constexpr int32_t kGrabTimeout = 5000;
+  // Tiles which could not be grabbed in a row before the media is considered
+  // unreadable. Nothing is cached then, so that it is retried later.
+  static constexpr int32_t kMaxGrabFailures = 3;
+
+  static std::string Key(std::shared_ptr<Media> media, int32_t interval,
+                         int32_t width) {
+    return media->cache_key() + "-" + std::to_string(interval) + "-" +
+           std::to_string(width);
+  }
+
+  std::optional<ThumbnailStrip> ReadIndex(const std::string& key) {
+    std::optional<CacheRecord> record = g_cache->Read(key, kIndexExtension);
+    ThumbnailStrip strip;
+    uint32_t sheet_count = 0, thumbnail_count = 0;
+    if (!record || !record->Get(strip.width) || !record->Get(strip.height) ||
+        !record->Get(sheet_count) || !record->Get(thumbnail_count)) {
+      return std::nullopt;
+    }
+    std::error_code error;
+    for (uint32_t index = 0; index < sheet_count; index++) {
+      auto path = SheetPath(key, index);
+      if (!std::filesystem::exists(path, error)) return std::nullopt;
+      strip.sheets.emplace_back(path.u8string());
+    }
+    strip.thumbnails.resize(thumbnail_count);
+    for (ThumbnailStrip::Thumbnail& thumbnail : strip.thumbnails) {
+      if (!record->Get(thumbnail.time) || !record->Get(thumbnail.sheet) ||
+          !record->Get(thumbnail.x) || !record->Get(thumbnail.y)) {
+        return std::nullopt;
+      }
+    }
+    return strip;
+  }
+
+  std::filesystem::path SheetPath(const std::string& key, uint32_t sheet) {
+    return g_cache->Path(key, "-" + std::to_string(sheet) + ".bmp");
+  }
+
+  std::optional<ThumbnailStrip> Generate(std::shared_ptr<Media> media,
+                                         const std::string& key,
+                                         int32_t interval, int32_t width) {
+    media->parse(kParseTimeout, 1u << Media::kMetaDuration, false);
+    int64_t duration = std::strtoll(media->metas()["duration"].c_str(),
+                                    nullptr, 10);
+    if (duration <= 0) return std::nullopt;
+    // Tiles fit within |width| x |width|, keeping the aspect ratio.
+    FrameGrabber grabber(media->location(), width, width,
+                         {":no-audio", ":no-spu", ":input-fast-seek",
+                          ":avcodec-skip-frame=3", ":avcodec-hurry-up"});
+    ThumbnailStrip strip;
+    std::vector<uint8_t> sheet;
+    int32_t tiles_per_sheet = kColumns * kRows;
+    int32_t failures = 0;
+    for (int64_t time = 0; time < duration; time += interval) {
+      // Any keyframe since the previous tile is close enough. A tile which
+      // could not be grabbed is skipped, scrubbing over it shows the previous
+      // one.
+      if (!grabber.Grab(time, interval, kGrabTimeout)) {
+        if (++failures == kMaxGrabFailures) return std::nullopt;
+        continue;
+      }
+      failures = 0;
+      int32_t index = static_cast<int32_t>(strip.thumbnails.size());
+      if (index == 0) {
+        strip.width = grabber.width();
+        strip.height = grabber.height();
+      }
+      int32_t tile = index % tiles_per_sheet;
+      if (tile == 0) {
+        if (index > 0 && !WriteSheet(key, strip, sheet)) return std::nullopt;
+        size_t tile_size = static_cast<size_t>(strip.width) * strip.height * 4;
+        sheet.assign(tile_size * tiles_per_sheet, 0);
+      }
+      ThumbnailStrip::Thumbnail thumbnail{
+          time, index / tiles_per_sheet, (tile % kColumns) * strip.width,
+          (tile / kColumns) * strip.height};
+      CopyTile(grabber, strip, thumbnail, sheet);
+      strip.thumbnails.emplace_back(thumbnail);
+    }
+    if (strip.thumbnails.empty() || !WriteSheet(key, strip, sheet)) {
+      return std::nullopt;
+    }
+    CacheRecord record;
+    record.Put(strip.width);
+    record.Put(strip.height);
+    record.Put(static_cast<uint32_t>(strip.sheets.size()));
+    record.Put(static_cast<uint32_t>(strip.thumbnails.size()));
+    for (const ThumbnailStrip::Thumbnail& thumbnail : strip.thumbnails) {
+      record.Put(thumbnail.time);
+      record.Put(thumbnail.sheet);
+      record.Put(thumbnail.x);
+      record.Put(thumbnail.y);
+    }
+    if (!g_cache->Write(key, kIndexExtension, record)) return std::nullopt;
+    return strip;
+  }
+
+  // Copies the grabbed frame into its tile. Frames all have the same size,
+  // the output format of |grabber| is negotiated once.
+  static void CopyTile(const FrameGrabber& grabber,
+                       const ThumbnailStrip& strip,
+                       const ThumbnailStrip::Thumbnail& thumbnail,
+                       std::vector<uint8_t>& sheet) {
+    int32_t width = std::min(grabber.width(), strip.width);
+    int32_t height = std::min(grabber.height(), strip.height);
+    size_t sheet_pitch = static_cast<size_t>(strip.width) * kColumns * 4;
+    for (int32_t row = 0; row < height; row++) {
+      memcpy(sheet.data() + (thumbnail.y + row) * sheet_pitch +
+                 thumbnail.x * 4,
+             grabber.frame().data() + row * grabber.width() * 4, width * 4);
+    }
+  }
+
+  // Writes the last sheet of |strip|, truncated to its used rows.
+  bool WriteSheet(const std::string& key, ThumbnailStrip& strip,
+                  const std::vector<uint8_t>& sheet) {
+    int32_t tiles_per_sheet = kColumns * kRows;
+    uint32_t index = static_cast<uint32_t>(strip.sheets.size());
+    int32_t tiles = static_cast<int32_t>(strip.thumbnails.size()) -
+                    index * tiles_per_sheet;
+    int32_t rows = std::min(kRows, (tiles + kColumns - 1) / kColumns);
+    auto path = SheetPath(key, index);
+    if (!FrameGrabber::SaveBitmap(path, sheet.data(), strip.width * kColumns,
+                                  strip.height * rows)) {
+      return false;
+    }
+    strip.sheets.emplace_back(path.u8string());
+    return true;
+  }
+
+  // A single pipeline at a time, strips are generated in the background
+  // while playback may be running.
+  ThreadPool pool_{1};
+};
+
+extern std::unique_ptr<ThumbnailCache> g_thumbnail_cache;
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ * dart_vlc: A media playback library for Dart & Flutter. Based on libVLC &
+ * libVLC++.
+ *
+ * Hitesh Kumar Saini
+ * https://github.com/alexmercerind
+ * saini123hitesh@gmail.com; alexmercerind@gmail.com
+ *
+ * GNU Lesser General Public License v2.1
+ */
+
+#ifndef WAVEFORM_H_
+#define WAVEFORM_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "internal/audiodecoder.h"
+#include "internal/mappedfile.h"
+#include "internal/threadpool.h"
+#include "mediasource/media.h"
+
+// Overview of the audio of a media for drawing waveforms, mapped from its
+// peaks file. Each level reduces buckets of |frames_per_bucket| frames to
+// their minimum, maximum & RMS per channel, stored as int16 triplets scaled
+// from [-1, 1]: |data[(bucket * channels + channel) * 3 + {0, 1, 2}]|.
+class Waveform {
+ public:
+  struct Level {
+    int32_t frames_per_bucket;
+    int32_t buckets;
+    const int16_t* data;
+  };
+
+  int32_t rate() const { return rate_; }
+  int32_t channels() const { return channels_; }
+  int64_t frames() const { return frames_; }
+  // From the finest to the coarsest.
+  const std::vector<Level>& levels() const { return levels_; }
+
+  // Maps the peaks file at |path|, returns nullptr if it is invalid.
+  static std::shared_ptr<const Waveform> Map(
+      const std::filesystem::path& path) {
+    auto waveform = std::shared_ptr<Waveform>(new Waveform(path));
+    return waveform->Parse() ? waveform : nullptr;
+  }
+
+ private:
+  explicit Waveform(const std::filesystem::path& path) : file_(path) {}
+
+  // See |WaveformGenerator::Write| for the layout.
+  bool Parse() {
+    const uint8_t* data = file_.data();
+    size_t size = file_.size(), offset = 0;
+    auto get = [&](auto& value) -> bool {
+      if (offset + sizeof(value) > size) return false;
+      std::memcpy(&value, data + offset, sizeof(value));
+      offset += sizeof(value);
+      return true;
+    };
+    uint32_t version = 0, level_count = 0;
+    if (!data || !get(version) || version != Cache::kVersion ||
+        !get(rate_) || !get(channels_) || !get(frames_) ||
+        !get(level_count) || channels_ <= 0) {
+      return false;
+    }
+    for (uint32_t index = 0; index < level_count; index++) {
+      Level level;
+      uint64_t level_offset = 0;
+      if (!get(level.frames_per_bucket) || !get(level.buckets) ||
+          !get(level_offset) ||
+          level_offset + static_cast<uint64_t>(level.buckets) * channels_ * 3 *
+                             sizeof(int16_t) >
+              size ||
+          level_offset % alignof(int16_t) != 0) {
+        return false;
+      }
+      level.data = reinterpret_cast<const int16_t*>(data + level_offset);
+      levels_.emplace_back(level);
+    }
+    return true;
+  }
+
+  MappedFile file_;
+  int32_t rate_ = 0;
+  int32_t channels_ = 0;
+  int64_t frames_ = 0;
+  std::vector<Level> levels_;
+};
+
+// Generates peaks files in the background, decoding as fast as possible
+// without any output, & stores them in |g_cache| as <key>.peaks.
+class WaveformGenerator {
+ public:
+  // Frames per bucket of the finest level, each following level is
+  // |kLevelRatio| times coarser.
+  static constexpr int32_t kBaseBucket = 256;
+  static constexpr int32_t kLevelRatio = 4;
+  static constexpr int32_t kLevelCount = 6;
+
+  // Called with the waveform, nullptr if the media could not be decoded.
+  typedef std::function<void(std::shared_ptr<const Waveform> waveform)>
+      Callback;
+
+  // Running generations are interrupted rather than waited for.
+  ~WaveformGenerator() { decoders_.Stop(); }
+
+  // Returns the waveform of |media| if it was generated before.
+  std::shared_ptr<const Waveform> Get(std::shared_ptr<Media> media) {
+    if (!g_cache->enabled()) return nullptr;
+    return Waveform::Map(g_cache->Path(media->cache_key(), kCacheExtension));
+  }
+
+  // Generates the waveform of |media| in the background if it was not
+  // generated yet. Jobs run in parallel, |callback| is invoked on a worker
+  // thread.
+  void Request(std::shared_ptr<Media> media, Callback callback) {
+    pool_.Post([=]() -> void {
+      std::shared_ptr<const Waveform> waveform = Get(media);
+      if (!waveform && Generate(media)) waveform = Get(media);
+      callback(waveform);
+    });
+  }
+
+ private:
+  static constexpr auto kCacheExtension = ".peaks";
+  static constexpr int32_t kChannels = AudioDecoder::kChannels;
+
+  // Sums of a bucket being reduced, per channel.
+  struct Bucket {
+    float minimum[kChannels];
+    float maximum[kChannels];
+    double squares[kChannels];
+    int32_t frames;
+  };
+
+  static Bucket EmptyBucket() {
+    Bucket bucket;
+    std::fill(std::begin(bucket.minimum), std::end(bucket.minimum), 1.0f);
+    std::fill(std::begin(bucket.maximum), std::end(bucket.maximum), -1.0f);
+    std::fill(std::begin(bucket.squares), std::end(bucket.squares), 0.0);
+    bucket.frames = 0;
+    return bucket;
+  }
+
+  bool Generate(std::shared_ptr<Media> media) {
+    if (!g_cache->enabled()) return false;
+    // Every level is reduced at once, the current bucket of each is kept.
+    std::vector<std::vector<int16_t>> levels(kLevelCount);
+    std::vector<Bucket> buckets(kLevelCount, EmptyBucket());
+    std::vector<int32_t> sizes(kLevelCount, kBaseBucket);
+    for (int32_t level = 1; level < kLevelCount; level++) {
+      sizes[level] = sizes[level - 1] * kLevelRatio;
+    }
+    int64_t frames = 0;
+    AudioDecoder decoder(
+        media->location(), [&](const float* samples, size_t count) -> void {
+          for (size_t frame = 0; frame < count; frame++) {
+            for (int32_t level = 0; level < kLevelCount; level++) {
+              Bucket& bucket = buckets[level];
+              for (int32_t channel = 0; channel < kChannels; channel++) {
+                float sample = std::clamp(
+                    samples[frame * kChannels + channel], -1.0f, 1.0f);
+                bucket.minimum[channel] =
+                    std::min(bucket.minimum[channel], sample);
+                bucket.maximum[channel] =
+                    std::max(bucket.maximum[channel], sample);
+                bucket.squares[channel] += sample * sample;
+              }
+              if (++bucket.frames == sizes[level]) {
+                Flush(bucket, levels[level]);
+              }
+            }
+          }
+          frames += count;
+        },
+        &decoders_);
+    if (!decoder.Decode()) return false;
+    for (int32_t level = 0; level < kLevelCount; level++) {
+      if (buckets[level].frames > 0) Flush(buckets[level], levels[level]);
+    }
+    return Write(media->cache_key(), frames, sizes, levels);
+  }
+
+  static void Flush(Bucket& bucket, std::vector<int16_t>& data) {
+    for (int32_t channel = 0; channel < kChannels; channel++) {
+      data.emplace_back(Quantize(bucket.minimum[channel]));
+      data.emplace_back(Quantize(bucket.maximum[channel]));
+      data.emplace_back(Quantize(static_cast<float>(
+          std::sqrt(bucket.squares[channel] / bucket.frames))));
+    }
+    bucket = EmptyBucket();
+  }
+
+  static int16_t Quantize(float value) {
+    return static_cast<int16_t>(std::lround(value * 32767.0f));
+  }
+
+  // Layout, in host byte order after the cache version: rate, channels &
+  // frames, the level count, then for each level its bucket size, bucket
+  // count & the offset of its data from the start of the file. The data of
+  // the levels follows.
+  bool Write(const std::string& key, int64_t frames,
+             const std::vector<int32_t>& sizes,
+             const std::vector<std::vector<int16_t>>& levels) {
+    CacheRecord record;
+    record.Put(AudioDecoder::kRate);
+    record.Put(kChannels);
+    record.Put(frames);
+    record.Put(static_cast<uint32_t>(levels.size()));
+    // Cache version, header & level table.
+    uint64_t offset = sizeof(uint32_t) + record.data().size() +
+                      levels.size() * (2 * sizeof(int32_t) + sizeof(uint64_t));
+    for (size_t level = 0; level < levels.size(); level++) {
+      record.Put(sizes[level]);
+      record.Put(static_cast<int32_t>(levels[level].size() / kChannels / 3));
+      record.Put(offset);
+      offset += levels[level].size() * sizeof(int16_t);
+    }
+    for (const std::vector<int16_t>& data : levels) {
+      record.Put(data.data(), data.size() * sizeof(int16_t));
+    }
+    return g_cache->Write(key, kCacheExtension, record);
+  }
+
+  AudioDecoderGroup decoders_;
+  ThreadPool pool_;
+};
+
+extern std::unique_ptr<WaveformGenerator> g_waveform_generator;
+
+#endif
@@ -225,28 +225,39 @@ final ReceivePort receiver = new ReceivePort()
         {
           players[id]!.current.index = event[2];
           players[id]!.current.isPlaylist = event[3];
-          List<Media> medias = [];
-          for (int index = 4; index < event.length; index += 2) {
+          // Only the entries modified since the previous event are sent,
+          // starting at event[5].
+          int size = event[4];
+          List<Media> medias = List<Media>.of(players[id]!.current.medias);
+          if (medias.length > size) medias.length = size;
+          for (int index = 6, position = event[5];
+              index < event.length;
+              index += 2, position++) {
+            Media media;
             switch (event[index]) {
               case 'MediaType.file':
                 {
-                  medias.add(Media.file(File(event[index + 1])));
+                  media = Media.file(File(event[index + 1]));
                   break;
                 }
               case 'MediaType.network':
                 {
-                  medias.add(Media.network(Uri.parse(event[index + 1])));
+                  media = Media.network(Uri.parse(event[index + 1]));
                   break;
                 }
-              case 'MediaType.directShow':
+              default:
                 {
-                  Media media = Media();
+                  media = Media();
                   media.mediaType = MediaType.directShow;
                   media.resource = event[index + 1];
-                  medias.add(media);
                   break;
                 }
             }
+            if (position < medias.length) {
+              medias[position] = media;
+            } else {
+              medias.add(media);
+            }
           }
           players[id]!.current.medias = medias;
           players[id]!.current.media = medias[players[id]!.current.index!];
@@ -268,6 +279,7 @@ final ReceivePort receiver = new ReceivePort()
           videoFrameCallback(id, event[2]);
           break;
         }
+      // Events of the APIs which have no Dart bindings yet, see CHANGELOG.md.
       default:
         break;
     }